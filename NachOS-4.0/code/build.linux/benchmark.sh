@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# benchmark.sh
+#	Measure how fast the simulator runs a user program, in simulated
+#	user instructions per second of host time, with all DEBUG
+#	categories compiled in (the default build) and with all of them
+#	compiled out (-DDEBUG_FLAGS='""', see ../lib/debug.h).
+#
+#	Each configuration is built in its own scratch directory next to
+#	this one, so the objects in this directory are left alone.
+#
+# Usage: ./benchmark.sh [nachos program] [extra nachos flags]
+#	(default program: ../test/matmult, which must already be built)
+#
+
+PROGRAM=${1:-../test/matmult}
+[ $# -gt 0 ] && shift
+EXTRA="$*"
+BASE="-DFILESYS_STUB -DRDATA -DSIM_FIX"
+
+run() {
+    name=$1
+    defines=$2
+    dir=../build.bench-$name
+
+    mkdir -p $dir
+    cp Makefile Makefile.dep $dir
+    (cd $dir && make depend DEFINES="$defines" > /dev/null &&
+	make nachos DEFINES="$defines" > /dev/null) || exit 1
+
+    start=`date +%s.%N`
+    ticks=`$dir/nachos -x $PROGRAM $EXTRA | grep '^Ticks:'`
+    end=`date +%s.%N`
+
+    echo "$ticks" | awk -v name=$name -v start=$start -v end=$end '{
+	user = $NF;		# one user tick per instruction
+	secs = end - start;
+	printf "%-8s %10d user instructions in %6.2f s = %12.0f instr/s\n",
+	    name, user, secs, user / secs;
+    }'
+}
+
+run debug "$BASE"
+run nodebug "$BASE -DDEBUG_FLAGS=\\\"\\\""
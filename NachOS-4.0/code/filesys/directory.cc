@@ -11,9 +11,13 @@
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
+//	The table is an open hash table: a name is stored at the entry
+//	its hash value selects, or at the next free one after it.  An
+//	entry whose file is removed is marked "removed" rather than
+//	free, so that names stored after it can still be found; these
+//	entries are reused by Add, and dropped when the table grows.
+//	Growing the table makes the directory file longer the next time
+//	it is written back.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,9 +25,27 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "debug.h"
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashName
+// 	Return a hash value for a file name.
+//
+//	"name" -- the file name
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 5381;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = hash * 33 + (unsigned char) name[i];
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -38,8 +60,11 @@ Directory::Directory(int size)
 {
     table = new DirectoryEntry[size];
     tableSize = size;
-    for (int i = 0; i < tableSize; i++)
+    numUsed = 0;
+    for (int i = 0; i < tableSize; i++) {
 	table[i].inUse = FALSE;
+	table[i].removed = FALSE;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -54,7 +79,8 @@ Directory::~Directory()
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table is made
+//	as big as the directory file.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -62,12 +88,24 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    int size = file->Length() / (int) sizeof(DirectoryEntry);
+
+    if (size != tableSize) {
+	delete [] table;
+	table = new DirectoryEntry[size];
+	tableSize = size;
+    }
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numUsed = 0;
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse || table[i].removed)
+	    numUsed++;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  If the 
+//	table has grown, this makes the file longer.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -89,9 +127,19 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
+    if (tableSize == 0)
+	return -1;
+
+    int start = HashName(name) % tableSize;
+
+    for (int j = 0; j < tableSize; j++) {
+	int i = (start + j) % tableSize;
+
+	if (!table[i].inUse && !table[i].removed)
+	    break;			// never used: the name would be here
         if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
+    }
     return -1;		// name not in directory
 }
 
@@ -114,31 +162,85 @@ Directory::Find(char *name)
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDirectory
+// 	Return TRUE if "name" is in the directory, and is a directory
+//	itself.
+//
+//	"name" -- the file name to look up
+//----------------------------------------------------------------------
+
+bool
+Directory::IsDirectory(char *name)
+{
+    int i = FindIndex(name);
+
+    return (i != -1) && table[i].isDirectory;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
-// 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+// 	Add a file into the directory, growing the table if it is getting
+//	full.  Return TRUE if successful; return FALSE if the file name is 
+//	already in the directory, or is too long.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the file being added a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDirectory)
 { 
-    if (FindIndex(name) != -1)
+    if (strlen(name) > FileNameMaxLen || FindIndex(name) != -1)
 	return FALSE;
+    if (4 * (numUsed + 1) > 3 * tableSize)
+	Resize(max(2 * tableSize, 8));
+
+    for (int j = 0; j < tableSize; j++) {
+	int i = (HashName(name) + j) % tableSize;
 
-    for (int i = 0; i < tableSize; i++)
         if (!table[i].inUse) {
+	    if (!table[i].removed)
+		numUsed++;
             table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
+	    table[i].removed = FALSE;
+	    table[i].isDirectory = isDirectory;
+            strncpy(table[i].name, name, FileNameMaxLen + 1); 
             table[i].sector = newSector;
-        return TRUE;
+	    return TRUE;
 	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    }
+    ASSERTNOTREACHED();		// we made sure there is room
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Move the entries in use into a new table with "size" entries,
+//	dropping removed entries along the way.
+//
+//	"size" -- the number of entries in the new table
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    DirectoryEntry *oldTable = table;
+    int oldSize = tableSize;
+
+    table = new DirectoryEntry[size];
+    tableSize = size;
+    numUsed = 0;
+    for (int i = 0; i < tableSize; i++) {
+	table[i].inUse = FALSE;
+	table[i].removed = FALSE;
+    }
+    for (int i = 0; i < oldSize; i++)
+	if (oldTable[i].inUse)
+	    (void) Add(oldTable[i].name, oldTable[i].sector, 
+				oldTable[i].isDirectory);
+    delete [] oldTable;
 }
 
 //----------------------------------------------------------------------
@@ -157,20 +259,50 @@ Directory::Remove(char *name)
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    table[i].removed = TRUE;
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if no file is in the directory, so that it can be
+//	removed.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    return FALSE;
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and under each 
+//	directory in it, the names in that directory.
+//
+//	"depth" -- how many directories deep we are, for indenting
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(int depth)
 {
    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+	if (table[i].inUse) {
+	    printf("%*s%s%s\n", 2 * depth, "", table[i].name,
+				table[i].isDirectory ? "/" : "");
+	    if (table[i].isDirectory) {
+		OpenFile *file = new OpenFile(table[i].sector);
+		Directory *directory = new Directory(0);
+
+		directory->FetchFrom(file);
+		directory->List(depth + 1);
+		delete directory;
+		delete file;
+	    }
+	}
 }
 
 //----------------------------------------------------------------------
@@ -187,10 +319,107 @@ Directory::Print()
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	    printf("Name: %s%s, Sector: %d\n", table[i].name, 
+			table[i].isDirectory ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
+	    if (table[i].isDirectory) {
+		OpenFile *file = new OpenFile(table[i].sector);
+		Directory *directory = new Directory(0);
+
+		directory->FetchFrom(file);
+		directory->Print();
+		delete directory;
+		delete file;
+	    }
 	}
     printf("\n");
     delete hdr;
 }
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Initialize an empty name cache.
+//----------------------------------------------------------------------
+
+NameCache::NameCache()
+{
+    for (int i = 0; i < NameCacheSize; i++)
+	entries[i].dirSector = -1;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Slot
+// 	Return the entry where a name would be cached.
+//
+//	"dirSector" -- the header sector of the directory holding the name
+//	"name" -- the file name
+//----------------------------------------------------------------------
+
+NameCacheEntry *
+NameCache::Slot(int dirSector, char *name)
+{
+    return &entries[(HashName(name) + dirSector) % NameCacheSize];
+}
+
+//----------------------------------------------------------------------
+// NameCache::Lookup
+// 	Return the header sector of a file, if we remember where it is,
+//	otherwise -1.
+//
+//	"dirSector" -- the header sector of the directory holding the name
+//	"name" -- the file name
+//	"isDirectory" -- set to whether the file is a directory
+//----------------------------------------------------------------------
+
+int
+NameCache::Lookup(int dirSector, char *name, bool *isDirectory)
+{
+    NameCacheEntry *entry = Slot(dirSector, name);
+
+    if (entry->dirSector != dirSector
+		|| strncmp(entry->name, name, FileNameMaxLen))
+	return -1;
+    *isDirectory = entry->isDirectory;
+    return entry->sector;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Enter
+// 	Remember where a file is, replacing whatever was cached in the
+//	same place.
+//
+//	"dirSector" -- the header sector of the directory holding the name
+//	"name" -- the file name
+//	"sector" -- the file's header sector
+//	"isDirectory" -- whether the file is a directory
+//----------------------------------------------------------------------
+
+void
+NameCache::Enter(int dirSector, char *name, int sector, bool isDirectory)
+{
+    NameCacheEntry *entry = Slot(dirSector, name);
+
+    entry->dirSector = dirSector;
+    entry->sector = sector;
+    entry->isDirectory = isDirectory;
+    strncpy(entry->name, name, FileNameMaxLen + 1);
+}
+
+//----------------------------------------------------------------------
+// NameCache::Forget
+// 	A file has been removed; make sure we do not remember it.
+//
+//	"dirSector" -- the header sector of the directory that held it
+//	"name" -- the file name
+//----------------------------------------------------------------------
+
+void
+NameCache::Forget(int dirSector, char *name)
+{
+    NameCacheEntry *entry = Slot(dirSector, name);
+
+    if (entry->dirSector == dirSector
+		&& !strncmp(entry->name, name, FileNameMaxLen))
+	entry->dirSector = -1;
+}
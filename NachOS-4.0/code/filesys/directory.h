@@ -4,7 +4,11 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry can 
+//	also name another directory, so that directories form a tree.
+//
+//	The table is a hash table, so that a name can be found without
+//	looking at every entry.  It grows as files are added.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -19,8 +23,10 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		23	// for simplicity, we assume 
+					// file names are <= 23 characters 
+					// long; this makes a directory
+					// entry 32 bytes
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,6 +38,10 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool removed;			// Was it in use, until the file was
+    					//   removed?  (It still counts when
+					//   looking for a name.)
+    bool isDirectory;			// Is the file a directory?
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -47,6 +57,10 @@ class DirectoryEntry {
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
 // from/to disk. 
+//
+// Each name is kept at the entry its hash value points to, or if that
+// is taken, at the first free entry after it (wrapping around).  The
+// table is doubled (and every name moved) when it gets 3/4 full.
 
 class Directory {
   public:
@@ -60,13 +74,18 @@ class Directory {
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
+    bool IsDirectory(char *name);	// Is "name" a directory?
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDirectory);
+    					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
+    bool IsEmpty();			// Is nothing in the directory?
 
-    void List();			// Print the names of all the files
-					//  in the directory
+    void List(int depth);		// Print the names of all the files
+					//  in the directory, and in the
+					//  directories under it, indented
+					//  by "depth"
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
@@ -75,9 +94,51 @@ class Directory {
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    int numUsed;			// Entries in use, or removed
 
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    void Resize(int size);		// Move the entries in use to a
+    					//  table with "size" entries
+};
+
+// The following class defines a cache of recent name lookups (in
+// UNIX terms, "dentries"), so that looking up a path that was used
+// recently does not need to read any directory.  Each entry maps the
+// sector of a directory's header, and a name in that directory, to 
+// the sector of the file's header.  An entry can only be cached in one
+// place, chosen by its hash value, so a new entry replaces whatever
+// was there.
+//
+// The file system must tell the cache when it removes a name.
+
+#define NameCacheSize		64	// entries in the cache
+
+class NameCacheEntry {
+  public:
+    int dirSector;			// the directory, or -1 if unused
+    int sector;				// the file
+    bool isDirectory;			// is the file a directory?
+    char name[FileNameMaxLen + 1];	// its name in the directory
+};
+
+class NameCache {
+  public:
+    NameCache();			// Initialize an empty cache
+
+    int Lookup(int dirSector, char *name, bool *isDirectory);
+    					// Return the sector of "name", or
+					//  -1 if it is not cached
+    void Enter(int dirSector, char *name, int sector, bool isDirectory);
+    					// Remember a lookup
+    void Forget(int dirSector, char *name);
+    					// "name" was removed
+
+  private:
+    NameCacheEntry entries[NameCacheSize];
+
+    NameCacheEntry *Slot(int dirSector, char *name);
+    					// Where "name" would be cached
 };
 
 #endif // DIRECTORY_H
@@ -5,10 +5,17 @@
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	disk sector containing that portion of the file data -- 
+//	followed by one indirect and one doubly indirect block, for
+//	the part of the file that does not fit in the table.  The table
+//	size is chosen so that the file header will be just big enough
+//	to fit in one disk sector.
+//
+//	Data blocks are allocated in the order they appear in the file,
+//	each one at the first free sector after the previous one, and
+//	starting at a run of free sectors large enough for the whole
+//	file if there is one.  That way reading the file sequentially
+//	rarely has to seek.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -26,40 +33,227 @@
 
 #include "filehdr.h"
 #include "debug.h"
-#include "synchdisk.h"
+#include "sectorcache.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// ReadEntry, WriteEntry
+// 	Read or change one pointer in an indirect block.
+//
+//	"block" is the disk sector holding the indirect block
+//	"index" is which of its pointers we want
+//	"sector" is the new value of the pointer
+//----------------------------------------------------------------------
+
+static int
+ReadEntry(int block, int index)
+{
+    int table[NumIndirect];
+
+    kernel->sectorCache->ReadSector(block, (char *) table);
+    return table[index];
+}
+
+static void
+WriteEntry(int block, int index, int sector)
+{
+    int table[NumIndirect];
+
+    kernel->sectorCache->ReadSector(block, (char *) table);
+    table[index] = sector;
+    kernel->sectorCache->WriteSector(block, (char *) table);
+}
+
+//----------------------------------------------------------------------
+// TotalSectors
+// 	Return the number of sectors a file with "dataSectors" data 
+//	blocks needs, counting its indirect blocks.
+//----------------------------------------------------------------------
+
+static int
+TotalSectors(int dataSectors)
+{
+    int beyond = dataSectors - NumDirect - NumIndirect;
+
+    if (dataSectors <= NumDirect)
+	return dataSectors;
+    if (beyond <= 0)
+	return dataSectors + 1;
+    return dataSectors + 2 + divRoundUp(beyond, NumIndirect);
+}
+
+//----------------------------------------------------------------------
+// NextFree
+// 	Allocate the first free sector at or after "*next" (wrapping 
+//	around to the start of the disk), and advance "*next" past it.
+//	There must be a free sector.
+//
+//	"freeMap" is the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+static int
+NextFree(PersistentBitmap *freeMap, int *next)
+{
+    int sector = -1;
+
+    if (*next < NumSectors)
+	sector = freeMap->NextClear(*next);
+    if (sector == -1)
+	sector = freeMap->NextClear(0);		// wrap around
+    ASSERT(sector != -1);
+    freeMap->Mark(sector);
+    *next = sector + 1;
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// NewIndirect
+// 	Allocate an indirect block, with no pointers in it yet.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"next" is where to start looking for a free sector
+//----------------------------------------------------------------------
+
+static int
+NewIndirect(PersistentBitmap *freeMap, int *next)
+{
+    int table[NumIndirect];
+    int sector = NextFree(freeMap, next);
+
+    for (int i = 0; i < NumIndirect; i++) {
+	table[i] = -1;
+    }
+    kernel->sectorCache->WriteSector(sector, (char *) table);
+    return sector;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
 //	Allocate data blocks for the file out of the map of free disk blocks.
 //	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	the new file, or it is too big for a file header.
+//
+//	The indirect blocks are written to disk here; the file header 
+//	itself is written by WriteBack.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the file
 //----------------------------------------------------------------------
 
 bool
 FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 { 
+    int total, next;
+
     numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    numSectors = 0;
+    indirectSector = doubleIndirectSector = -1;
+    total = TotalSectors(divRoundUp(fileSize, SectorSize));
+    if (divRoundUp(fileSize, SectorSize) > MaxFileSectors
+		|| freeMap->NumClear() < total)
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++) {
-	dataSectors[i] = freeMap->FindAndSet();
-	// since we checked that there was enough free space,
-	// we expect this to succeed
-	ASSERT(dataSectors[i] >= 0);
+    next = (total > 0) ? max(freeMap->FindRun(total), 0) : 0;
+    while (numSectors < divRoundUp(fileSize, SectorSize)) {
+	AddSector(freeMap, &next);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Allocate more data blocks for a file that is growing, so that it
+//	can hold at least "fileSize" bytes.  Since a growing file usually
+//	keeps growing, allocate at least GrowSectors blocks at a time if 
+//	there is room, right after the file's last block if they are 
+//	free.  The file's length does not change; see SetLength.
+//
+//	Return FALSE if there are not enough free blocks.  The indirect 
+//	blocks are written to disk here; the file header is not.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes the file needs room for
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(PersistentBitmap *freeMap, int fileSize)
+{
+    int needed = divRoundUp(fileSize, SectorSize);
+    int wanted, next;
+
+    if (needed <= numSectors)
+	return TRUE;		// there is room already
+    if (needed > MaxFileSectors
+		|| TotalSectors(needed) - TotalSectors(numSectors) 
+			> freeMap->NumClear())
+	return FALSE;		// not enough space
+
+    wanted = min(max(needed, numSectors + GrowSectors), MaxFileSectors);
+    while (TotalSectors(wanted) - TotalSectors(numSectors) 
+		> freeMap->NumClear()) {
+	wanted--;		// take what we can get
+    }
+    if (numSectors > 0)
+	next = ByteToSector((numSectors - 1) * SectorSize) + 1;
+    else
+	next = max(freeMap->FindRun(TotalSectors(wanted)), 0);
+
+    DEBUG(dbgFile, "Extending file from " << numSectors << " to " 
+		<< wanted << " sectors");
+    while (numSectors < wanted) {
+	AddSector(freeMap, &next);
     }
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::AddSector
+// 	Allocate a data block for the sector after the last one in the 
+//	file, and any indirect block needed to point to it.  There must
+//	be enough free sectors for all of them.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"next" is where to start looking for free sectors
+//----------------------------------------------------------------------
+
+void
+FileHeader::AddSector(PersistentBitmap *freeMap, int *next)
+{
+    int i = numSectors;
+    int block;
+
+    ASSERT(numSectors < MaxFileSectors);
+    numSectors++;
+    if (i < NumDirect) {
+	dataSectors[i] = NextFree(freeMap, next);
+	return;
+    }
+
+    i -= NumDirect;
+    if (i < NumIndirect) {
+	if (indirectSector == -1)
+	    indirectSector = NewIndirect(freeMap, next);
+	WriteEntry(indirectSector, i, NextFree(freeMap, next));
+	return;
+    }
+
+    i -= NumIndirect;
+    if (doubleIndirectSector == -1)
+	doubleIndirectSector = NewIndirect(freeMap, next);
+    if (i % NumIndirect == 0) {
+	block = NewIndirect(freeMap, next);
+	WriteEntry(doubleIndirectSector, i / NumIndirect, block);
+    } else {
+	block = ReadEntry(doubleIndirectSector, i / NumIndirect);
+    }
+    WriteEntry(block, i % NumIndirect, NextFree(freeMap, next));
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for its indirect blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -67,9 +261,24 @@ FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(PersistentBitmap *freeMap)
 {
+    int numBlocks;
+
     for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+	int sector = ByteToSector(i * SectorSize);
+
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (doubleIndirectSector != -1) {
+	numBlocks = divRoundUp(numSectors - NumDirect - NumIndirect, 
+				NumIndirect);
+	for (int i = 0; i < numBlocks; i++) {
+	    freeMap->Clear(ReadEntry(doubleIndirectSector, i));
+	}
+	freeMap->Clear(doubleIndirectSector);
+    }
+    if (indirectSector != -1) {
+	freeMap->Clear(indirectSector);
     }
 }
 
@@ -83,7 +292,7 @@ FileHeader::Deallocate(PersistentBitmap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
+    kernel->sectorCache->ReadSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
@@ -96,7 +305,7 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    kernel->synchDisk->WriteSector(sector, (char *)this); 
+    kernel->sectorCache->WriteSector(sector, (char *)this); 
 }
 
 //----------------------------------------------------------------------
@@ -104,7 +313,8 @@ FileHeader::WriteBack(int sector)
 // 	Return which disk sector is storing a particular byte within the file.
 //      This is essentially a translation from a virtual address (the
 //	offset in the file) to a physical address (the sector where the
-//	data at the offset is stored).
+//	data at the offset is stored).  Beyond the first NumDirect
+//	sectors, this has to look in the indirect blocks.
 //
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
@@ -112,7 +322,16 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int i = offset / SectorSize;
+
+    if (i < NumDirect)
+	return(dataSectors[i]);
+    i -= NumDirect;
+    if (i < NumIndirect)
+	return ReadEntry(indirectSector, i);
+    i -= NumIndirect;
+    return ReadEntry(ReadEntry(doubleIndirectSector, i / NumIndirect), 
+			i % NumIndirect);
 }
 
 //----------------------------------------------------------------------
@@ -126,6 +345,33 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Capacity
+// 	Return the number of bytes the file can hold in the data blocks
+//	it already has.
+//----------------------------------------------------------------------
+
+int
+FileHeader::Capacity()
+{
+    return numSectors * SectorSize;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SetLength
+// 	Change the number of bytes in the file.  The file must have room
+//	for them (see Extend).
+//
+//	"fileSize" is the new length of the file
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetLength(int fileSize)
+{
+    ASSERT(fileSize <= Capacity());
+    numBytes = fileSize;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -140,10 +386,10 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+	printf("%d ", ByteToSector(i * SectorSize));
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
+	kernel->sectorCache->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
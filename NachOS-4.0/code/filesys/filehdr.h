@@ -17,19 +17,26 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumDirect 	((int) ((SectorSize - 4 * sizeof(int)) / sizeof(int)))
+#define NumIndirect	((int) (SectorSize / sizeof(int)))
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
+#define GrowSectors	8	// data blocks to add at a time when a
+				// file grows
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// As in UNIX, the file header is organized as a table of pointers to
+// the first NumDirect data blocks, followed by a pointer to an indirect 
+// block (a sector full of pointers to the next NumIndirect data blocks), 
+// and a pointer to a doubly indirect block (a sector full of pointers to
+// indirect blocks).
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.  The indirect blocks stay on disk (or in the
+// sector cache); they are read when they are needed.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -42,6 +49,9 @@ class FileHeader {
 						//  on disk for the file data
     void Deallocate(PersistentBitmap *bitMap);  // De-allocate this file's 
 						//  data blocks
+    bool Extend(PersistentBitmap *bitMap, int fileSize);
+    						// Allocate more data blocks,
+						//  so that the file can grow
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
     void WriteBack(int sectorNumber); 	// Write modifications to file header
@@ -53,14 +63,26 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    int Capacity();			// Return how long the file can get
+    					// without allocating data blocks
+    void SetLength(int fileSize);	// Change the length of the file,
+    					// within its capacity
 
     void Print();			// Print the contents of the file.
 
   private:
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int dataSectors[NumDirect];		// Disk sector numbers for the first
+					// NumDirect data blocks in the file
+    int indirectSector;			// Indirect block for the next 
+    					// NumIndirect data blocks, or -1
+    int doubleIndirectSector;		// Doubly indirect block for the rest,
+    					// or -1
+
+    void AddSector(PersistentBitmap *freeMap, int *next);
+    					// Allocate the next data sector, and
+					// any indirect blocks it needs
 };
 
 #endif // FILEHDR_H
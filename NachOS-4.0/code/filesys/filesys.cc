@@ -21,23 +21,37 @@
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
+//	Files are named by paths, like "/usr/bin/cat": each name but the
+//	last is a directory, starting from the root directory (a leading
+//	"/" is optional).  Other directories are files too, named in their
+//	parent directory.  Recently looked up names are remembered in a 
+//	name cache, so that opening the same path again does not read the
+//	directories along the way.
+//
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are written back (the two files are kept open during all this
+//	time).  If the operation fails, and we have modified part of the
+//	directory and/or bitmap, we simply discard the changed version,
+//	without writing it back.
+//
+//	Every such operation is bracketed by Begin and End on the journal
+//	(see journal.h), so that its changes reach the disk all together
+//	or not at all, along with those of other operations around it.
+//	The last sectors of the disk hold the journal's log.  If Nachos
+//	exits in the middle of things, the log is replayed the next time
+//	the disk is mounted.
+//
+//	The journal also keeps operations of different threads apart: a
+//	thread that calls Begin waits until no other thread is in the
+//	middle of an operation.  Open looks its path up the same way, so
+//	that it never sees a directory half way through a change.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   file data is not synchronized: two threads writing the same
+//		part of a file may interleave
+//	   file data is not journaled, only the structures describing it
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -51,6 +65,9 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "journal.h"
+#include "sectorcache.h"
+#include "main.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -58,11 +75,10 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directories; directories grow
+// when they fill up.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
+#define NumDirEntries 		16
 #define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
 //----------------------------------------------------------------------
@@ -70,17 +86,23 @@
 // 	Initialize the file system.  If format = TRUE, the disk has
 //	nothing on it, and we need to initialize the disk to contain
 //	an empty directory, and a bitmap of free sectors (with almost but
-//	not all of the sectors marked as free).  
+//	not all of the sectors marked as free), and an empty log.
 //
-//	If format = FALSE, we just have to open the files
+//	If format = FALSE, we first replay the log, in case Nachos did 
+//	not shut down cleanly, and then we just have to open the files
 //	representing the bitmap and the directory.
 //
+//	Either way, the sector cache records changes in the journal from
+//	then on.
+//
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format)
 { 
     DEBUG(dbgFile, "Initializing the file system.");
+    nameCache = new NameCache;
+    journal = new Journal;
     if (format) {
         PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
@@ -93,6 +115,9 @@ FileSystem::FileSystem(bool format)
     // (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	for (int i = LogSector; i < NumSectors; i++)
+	    freeMap->Mark(i);
+	journal->Reset();
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
@@ -135,20 +160,126 @@ FileSystem::FileSystem(bool format)
 	delete mapHdr; 
 	delete dirHdr;
     } else {
-    // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // if we are not formatting the disk, redo whatever the log says,
+    // and open the files representing the bitmap and directory; these
+    // are left open while Nachos is running
+        journal->Replay();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
     }
+    kernel->sectorCache->SetJournal(journal);
 }
 
 //----------------------------------------------------------------------
-// FileSystem::Create
-// 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+// FileSystem::OpenDirectory, FileSystem::CloseDirectory
+// 	Open (and close) the file holding a directory.  The root directory
+//	is kept open; closing it only makes sure its header is on disk, in 
+//	case it grew.
+//
+//	"sector" -- the location of the directory's file header
+//	"file" -- the directory file, from OpenDirectory
+//----------------------------------------------------------------------
+
+OpenFile *
+FileSystem::OpenDirectory(int sector)
+{
+    if (sector == DirectorySector)
+	return directoryFile;
+    return new OpenFile(sector);
+}
+
+void
+FileSystem::CloseDirectory(OpenFile *file)
+{
+    if (file == directoryFile)
+	file->Sync();
+    else
+	delete file;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupIn
+// 	Look up a name in a directory, in the name cache if possible.
+//	Return the location of its file header, or -1 if it is not there.
+//
+//	"dirSector" -- the location of the directory's file header
+//	"name" -- the name to look up
+//	"isDirectory" -- set to whether the name is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupIn(int dirSector, char *name, bool *isDirectory)
+{
+    Directory *directory;
+    OpenFile *file;
+    int sector;
+
+    sector = nameCache->Lookup(dirSector, name, isDirectory);
+    if (sector != -1)
+	return sector;
+
+    directory = new Directory(0);
+    file = OpenDirectory(dirSector);
+    directory->FetchFrom(file);
+    sector = directory->Find(name);
+    *isDirectory = directory->IsDirectory(name);
+    CloseDirectory(file);
+    delete directory;
+
+    if (sector != -1)
+	nameCache->Enter(dirSector, name, sector, *isDirectory);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Find the directory that a path names a file in: follow every name
+//	in the path, but the last one, from the root directory.  Return
+//	the location of the directory's file header, and copy the last name
+//	into "name".
+//
+//	Return -1 if some directory along the way does not exist, or if
+//	some name is too long, or if the path has no names at all.
+//
+//	"path" -- the path of the file
+//	"name" -- where to put the last name in the path; it must have
+//		room for FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindParent(char *path, char *name)
+{
+    int dirSector = DirectorySector;
+    bool isDirectory;
+    int length;
+
+    for (;;) {
+	while (*path == '/')
+	    path++;
+	length = strcspn(path, "/");
+	if (length == 0 || length > FileNameMaxLen)
+	    return -1;
+	strncpy(name, path, length);
+	name[length] = '\0';
+	path += length;
+	while (*path == '/')
+	    path++;
+	if (*path == '\0')
+	    return dirSector;		// that was the last name
+
+	dirSector = LookupIn(dirSector, name, &isDirectory);
+	if (dirSector == -1 || !isDirectory)
+	    return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Create a file (or a directory) named by a path.  The file's data
+//	blocks are allocated but not initialized.
 //
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
@@ -156,34 +287,37 @@ FileSystem::FileSystem(bool format)
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
 //
-//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//	Return the location of the new file header, or -1 if something
+//	went wrong.
 //
-// 	Create fails if:
-//   		file is already in directory
-//	 	no free space for file header
-//	 	no free entry for file in directory
-//	 	no free space for data blocks for the file 
-//
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+//	The caller must be in a journal operation (Begin), which keeps
+//	other threads out of the file system meanwhile.
 //
-//	"name" -- name of file to be created
+//	"path" -- path of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDirectory" -- is it a directory?
 //----------------------------------------------------------------------
 
-bool
-FileSystem::Create(char *name, int initialSize)
+int
+FileSystem::CreateEntry(char *path, int initialSize, bool isDirectory)
 {
+    char name[FileNameMaxLen + 1];
     Directory *directory;
+    OpenFile *dirFile;
     PersistentBitmap *freeMap;
     FileHeader *hdr;
-    int sector;
+    int dirSector, sector;
     bool success;
 
-    DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+    DEBUG(dbgFile, "Creating file " << path << " size " << initialSize);
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    dirSector = FindParent(path, name);
+    if (dirSector == -1)
+	return -1;			// no such directory
+
+    directory = new Directory(0);
+    dirFile = OpenDirectory(dirSector);
+    directory->FetchFrom(dirFile);
 
     if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
@@ -192,50 +326,114 @@ FileSystem::Create(char *name, int initialSize)
         sector = freeMap->FindAndSet();	// find a sector to hold the file header
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
+        else if (!directory->Add(name, sector, isDirectory))
+            success = FALSE;	// name too long
 	else {
     	    hdr = new FileHeader;
 	    if (!hdr->Allocate(freeMap, initialSize))
             	success = FALSE;	// no space on disk for data
 	    else {	
 	    	success = TRUE;
-		// everthing worked, flush all changes back to disk
+		// everthing worked, flush all changes back to disk; the
+		// bitmap first, in case the directory has to grow
     	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
     	    	freeMap->WriteBack(freeMapFile);
+    	    	directory->WriteBack(dirFile);
+		nameCache->Enter(dirSector, name, sector, isDirectory);
 	    }
             delete hdr;
 	}
         delete freeMap;
     }
+    CloseDirectory(dirFile);
     delete directory;
-    return success;
+    return success ? sector : -1;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Create
+// 	Create a file in the Nachos file system (similar to UNIX create).
+//	The file can grow later, but it can be given an initial size, to
+//	allocate all of its space at once.
+//
+//	Return TRUE if everything goes ok, otherwise, return FALSE.
+//
+// 	Create fails if:
+//   		file is already in directory
+//		some directory along the path does not exist
+//	 	no free space for file header
+//	 	no free space for data blocks for the file 
+//
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    int sector;
+
+    journal->Begin();
+    sector = CreateEntry(name, initialSize, FALSE);
+    journal->End();
+    return sector != -1;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateDirectory
+// 	Create an empty directory (similar to UNIX mkdir).  Fails for the
+//	same reasons as Create.
+//
+//	"name" -- path of the directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::CreateDirectory(char *name)
+{
+    Directory *directory;
+    OpenFile *file;
+    int sector;
+
+    journal->Begin();
+    sector = CreateEntry(name, DirectoryFileSize, TRUE);
+    if (sector != -1) {
+	directory = new Directory(NumDirEntries);
+	file = new OpenFile(sector);
+	directory->WriteBack(file);
+	delete file;
+	delete directory;
+    }
+    journal->End();
+    return sector != -1;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened; it cannot be a 
+//		directory
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    char last[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
+    bool isDirectory;
     int sector;
 
     DEBUG(dbgFile, "Opening file" << name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
+    journal->Begin();				// no changes meanwhile
+    sector = FindParent(name, last);
+    if (sector >= 0)
+	sector = LookupIn(sector, last, &isDirectory);
+    journal->End();
+    if (sector >= 0 && !isDirectory)
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
     return openFile;				// return NULL if not found
 }
 
@@ -248,25 +446,46 @@ FileSystem::Open(char *name)
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory that is not empty.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
 { 
+    char last[FileNameMaxLen + 1];
     Directory *directory;
+    OpenFile *dirFile;
     PersistentBitmap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    int dirSector, sector;
+    bool empty = TRUE;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
+    journal->Begin();
+    dirSector = FindParent(name, last);
+    if (dirSector == -1) {
+	journal->End();
+	return FALSE;			// no such directory
+    }
+    directory = new Directory(0);
+    dirFile = OpenDirectory(dirSector);
+    directory->FetchFrom(dirFile);
+    sector = directory->Find(last);
+    if (sector != -1 && directory->IsDirectory(last)) {
+	Directory *contents = new Directory(0);
+	OpenFile *file = new OpenFile(sector);
+
+	contents->FetchFrom(file);
+	empty = contents->IsEmpty();
+	delete file;
+	delete contents;
+    }
+    if (sector == -1 || !empty) {
+       CloseDirectory(dirFile);
        delete directory;
-       return FALSE;			 // file not found 
+       journal->End();
+       return FALSE;			 // file not found, or not empty
     }
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
@@ -275,19 +494,68 @@ FileSystem::Remove(char *name)
 
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    directory->Remove(last);
+    nameCache->Forget(dirSector, last);
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
+    directory->WriteBack(dirFile);        	// flush to disk
+    CloseDirectory(dirFile);
+    journal->End();
     delete fileHdr;
     delete directory;
     delete freeMap;
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Allocate data blocks for an open file that is growing, so that
+//	it can hold "fileSize" bytes.  The file header is changed only in
+//	memory; writing it back to disk is up to the OpenFile.
+//
+//	Return FALSE if the disk is full.
+//
+//	"hdr" -- the header of the growing file
+//	"fileSize" -- how many bytes it needs room for
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(FileHeader *hdr, int fileSize)
+{
+    PersistentBitmap *freeMap;
+    bool success;
+
+    journal->Begin();
+    freeMap = new PersistentBitmap(freeMapFile,NumSectors);
+    success = hdr->Extend(freeMap, fileSize);
+    if (success)
+	freeMap->WriteBack(freeMapFile);	// flush to disk
+    delete freeMap;
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WriteHeader
+// 	Write back the header of an open file that has grown.  This is an
+//	operation of its own, since the blocks the file grew into were
+//	allocated (by Extend) in an earlier one.
+//
+//	"hdr" -- the header of the file
+//	"sector" -- where it goes on disk
+//----------------------------------------------------------------------
+
+void
+FileSystem::WriteHeader(FileHeader *hdr, int sector)
+{
+    journal->Begin();
+    hdr->WriteBack(sector);
+    journal->End();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, directory by directory.
 //----------------------------------------------------------------------
 
 void
@@ -296,7 +564,7 @@ FileSystem::List()
     Directory *directory = new Directory(NumDirEntries);
 
     directory->FetchFrom(directoryFile);
-    directory->List();
+    directory->List(0);
     delete directory;
 }
 
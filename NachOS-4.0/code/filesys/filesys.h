@@ -18,9 +18,9 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
+//	in the file system.  There is a "root" directory, listing the files
+//	and directories at the top of the tree; as in UNIX, files are named
+//	by paths through the tree, like "/dir/file".
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
@@ -225,6 +225,22 @@ public:
         return openingFiles[id]->Seek(position);
     }
 
+    /** Get the identity of an open file
+     *
+     * @param id file id
+     * @return the identity of the file (see OpenFile::Identity), -1 if id is not valid or file is not opened
+     */
+    int Identity(OpenFileId id)
+    {
+        if (id < 2 || id >= MAX_OPEN_FILES)
+            return -1;
+
+        if (openingFiles[id] == NULL)
+            return -1;
+
+        return openingFiles[id]->Identity();
+    }
+
     /** Remove a file
      *
      * @param name file name
@@ -305,6 +321,10 @@ private:
 
 #else // FILESYS
 
+class FileHeader;
+class NameCache;
+class Journal;
+
 class FileSystem {
 public:
     FileSystem(bool format);		// Initialize the file system.
@@ -317,11 +337,20 @@ public:
     bool Create(char* name, int initialSize);
     // Create a file (UNIX creat)
 
+    bool CreateDirectory(char* name);	// Create a directory (UNIX mkdir)
+
     OpenFile* Open(char* name); 	// Open a file (UNIX open)
 
     bool Remove(char* name);  		// Delete a file (UNIX unlink)
 
+    bool Extend(FileHeader* hdr, int fileSize);
+    // Allocate room for an open file to grow
+    void WriteHeader(FileHeader* hdr, int sector);
+    // Write back the header of an open file
+    // that has grown
+
     void List();			// List all the files in the file system
+                    // (the whole tree)
 
     void Print();			// List all the files and their contents
 
@@ -330,6 +359,19 @@ private:
                      // represented as a file
     OpenFile* directoryFile;		// "Root" directory -- list of 
                      // file names, represented as a file
+    NameCache* nameCache;		// Recent lookups of names in
+                     // directories
+    Journal* journal;			// Log of changes to the
+                     // file system structures
+
+    OpenFile* OpenDirectory(int sector);	// Open/close a directory file
+    void CloseDirectory(OpenFile* file);
+    int LookupIn(int dirSector, char* name, bool* isDirectory);
+    // Find a name in a directory
+    int FindParent(char* path, char* name);
+    // Find the directory a path leads to
+    int CreateEntry(char* path, int initialSize, bool isDirectory);
+    // Create a file or directory
 };
 
 #endif // FILESYS
@@ -0,0 +1,332 @@
+// journal.cc
+//	Routines to log file system metadata ahead of writing it home.
+//
+//	The sectors of a transaction are written to the log all at once,
+//	in consecutive sectors, so the disk serves them in one sweep.  The
+//	header is written after they are all on disk; writing one sector
+//	is atomic, so a crash leaves either the old header or the new one.
+//	Before any of that, the previous transaction is checkpointed and
+//	the log marked empty, so that a crash in the middle of rewriting
+//	the log never replays a mix of old and new sectors.
+//
+//	Only one operation at a time may be in progress, or one of them
+//	could commit half of another along with it.  Since the file 
+//	system is used by many threads, Begin waits for the journal's lock,
+//	which is held until the outermost End; Commit and Checkpoint, when
+//	the sector cache calls them, wait for it too.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "sectorcache.h"
+#include "synchdisk.h"
+#include "synch.h"
+#include "main.h"
+
+// Marks a sector as a log header, rather than whatever was on the
+// disk before it was formatted.
+#define LogMagic	0x4a4e4c47
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal: no operation is in progress, and nothing
+//	is logged.  The log on disk is left alone; call Reset or Replay.
+//----------------------------------------------------------------------
+
+Journal::Journal()
+{
+    ASSERT(sizeof(LogHeader) == SectorSize);
+    ASSERT(CommitThreshold < NumCacheSectors / 2);
+
+    lock = new Lock("journal");
+    depth = 0;
+    sequence = 0;
+    numPending = 0;
+    pendingData = new char[MaxLogged * SectorSize];
+    numCommitted = 0;
+    committedData = new char[MaxLogged * SectorSize];
+    written = new Semaphore("journal", 0);
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    delete [] pendingData;
+    delete [] committedData;
+    delete written;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Journal::Reset
+// 	Write an empty log, on a disk that has just been formatted.
+//----------------------------------------------------------------------
+
+void
+Journal::Reset()
+{
+    WriteHeader(0);
+}
+
+//----------------------------------------------------------------------
+// Journal::Replay
+// 	Called when the disk is mounted.  If Nachos crashed, the log may
+//	hold a committed transaction that did not all make it home; copy
+//	every sector in it to its home location.  Doing so when it did
+//	all make it home does no harm.  Then empty the log.
+//
+//	Nothing is cached yet, so the sectors are copied straight from
+//	the disk to the disk.
+//----------------------------------------------------------------------
+
+void
+Journal::Replay()
+{
+    LogHeader *header = new LogHeader;
+    char *data = new char[SectorSize];
+
+    kernel->synchDisk->ReadSector(LogSector, (char *) header);
+    if (header->magic == LogMagic) {
+	sequence = header->sequence;
+	if (header->numSectors > 0 && header->numSectors <= MaxLogged) {
+	    DEBUG(dbgFile, "Replaying transaction " << sequence << ", "
+	    			<< header->numSectors << " sectors");
+	    for (int i = 0; i < header->numSectors; i++) {
+		kernel->synchDisk->ReadSector(LogSector + 1 + i, data);
+		kernel->synchDisk->WriteSector(header->sectors[i], data);
+	    }
+	}
+    }
+    WriteHeader(0);
+    delete header;
+    delete [] data;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin, Journal::End
+// 	Bracket a file system operation: every sector the sector cache
+//	is asked to write in between belongs to the open transaction.
+//	An operation may call another one (creating a file may grow its
+//	directory); only the outermost End counts.  The thread holds the
+//	journal's lock from the outermost Begin to the outermost End, so
+//	operations of different threads do not mix.
+//
+//	The transaction is committed at the end of an operation, once it
+//	is big enough; smaller ones wait for more operations to join them.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    if (!lock->IsHeldByCurrentThread())
+	lock->Acquire();
+    depth++;
+}
+
+void
+Journal::End()
+{
+    ASSERT(depth > 0 && lock->IsHeldByCurrentThread());
+
+    depth--;
+    if (depth == 0) {
+	if (numPending >= CommitThreshold)
+	    Commit();
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::Logging
+// 	Return TRUE if the current thread is in the middle of an
+//	operation, so that what it writes belongs to the transaction.
+//	Other threads write file data, which is not logged.
+//----------------------------------------------------------------------
+
+bool
+Journal::Logging()
+{
+    return depth > 0 && lock->IsHeldByCurrentThread();
+}
+
+//----------------------------------------------------------------------
+// Journal::Record
+// 	Called by the sector cache when the current operation writes a
+//	sector, which the cache keeps pinned until the transaction is
+//	committed.  Keep a copy for the log; a sector written again is
+//	logged once, with its latest contents.
+//
+//	If the transaction is full, it has to be committed in the middle
+//	of the operation, which is then no longer atomic.  That happens
+//	when one operation writes more than MaxLogged sectors: a Create or
+//	Extend of a large file (a sector for every indirect block), or a 
+//	large directory growing.
+//
+//	"sectorNumber" -- the sector written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+void
+Journal::Record(int sectorNumber, char *data)
+{
+    int i = Find(sectorNumber, pending, numPending);
+
+    if (i == -1) {
+	if (numPending == MaxLogged) {
+	    DEBUG(dbgFile, "Log full in the middle of an operation");
+	    Commit();
+	}
+	i = numPending++;
+	pending[i] = sectorNumber;
+    }
+    bcopy(data, &pendingData[i * SectorSize], SectorSize);
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Make the open transaction permanent: checkpoint the last one,
+//	write the sectors of this one to the log, and then the header
+//	that commits it.  From then on, the sectors can go home, so the
+//	cache may write them back.
+//
+//	Called by the sector cache, outside any operation, we first wait
+//	for the operation in progress, if any, to end.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    char *data;
+
+    if (!lock->IsHeldByCurrentThread()) {
+	lock->Acquire();
+	Commit();
+	lock->Release();
+	return;
+    }
+    if (numPending == 0)
+	return;
+
+    Checkpoint();
+
+    DEBUG(dbgFile, "Committing transaction " << sequence + 1 << ", "
+    			<< numPending << " sectors");
+    for (int i = 0; i < numPending; i++) {
+	kernel->synchDisk->WriteRequest(LogSector + 1 + i,
+				&pendingData[i * SectorSize], this);
+    }
+    for (int i = 0; i < numPending; i++) {
+	written->P();
+    }
+    sequence++;
+    WriteHeader(numPending);		// the commit point
+    kernel->stats->numLogCommits++;
+    kernel->stats->numLogSectors += numPending;
+
+    data = committedData;		// the transaction is now committed
+    committedData = pendingData;
+    pendingData = data;
+    for (int i = 0; i < numPending; i++) {
+	committed[i] = pending[i];
+    }
+    numCommitted = numPending;
+    numPending = 0;
+    for (int i = 0; i < numCommitted; i++) {
+	kernel->sectorCache->Unpin(committed[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Make sure every sector of the committed transaction is at home,
+//	so that the log is no longer needed, and mark it empty.
+//
+//	Most of them are just written back from the cache, if they are
+//	still dirty there.  A sector that the open transaction has changed
+//	since is pinned, and its cached contents are not committed; the
+//	committed version is written home from our own copy instead.
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    if (!lock->IsHeldByCurrentThread()) {
+	lock->Acquire();		// see Commit
+	Checkpoint();
+	lock->Release();
+	return;
+    }
+    if (numCommitted == 0)
+	return;
+
+    DEBUG(dbgFile, "Checkpointing transaction " << sequence);
+    for (int i = 0; i < numCommitted; i++) {
+	if (Find(committed[i], pending, numPending) == -1) {
+	    kernel->sectorCache->Flush(committed[i]);
+	} else {
+	    kernel->synchDisk->WriteSector(committed[i],
+	    			&committedData[i * SectorSize]);
+	}
+    }
+    numCommitted = 0;
+    WriteHeader(0);
+}
+
+//----------------------------------------------------------------------
+// Journal::CallBack
+// 	Disk interrupt handler, when a write to the log is done.
+//----------------------------------------------------------------------
+
+void
+Journal::CallBack()
+{
+    written->V();
+}
+
+//----------------------------------------------------------------------
+// Journal::Find
+// 	Return where a sector is in a list of logged sectors, or -1.
+//
+//	"sectorNumber" -- the sector to look for
+//	"sectors", "count" -- the list
+//----------------------------------------------------------------------
+
+int
+Journal::Find(int sectorNumber, int *sectors, int count)
+{
+    for (int i = 0; i < count; i++) {
+	if (sectors[i] == sectorNumber)
+	    return i;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHeader
+// 	Write the log header, straight to the disk.
+//
+//	"count" -- how many sectors of the open transaction are in the
+//		log, or 0 to mark the log empty
+//----------------------------------------------------------------------
+
+void
+Journal::WriteHeader(int count)
+{
+    LogHeader *header = new LogHeader;
+
+    header->magic = LogMagic;
+    header->sequence = sequence;
+    header->numSectors = count;
+    for (int i = 0; i < MaxLogged; i++) {
+	header->sectors[i] = (i < count) ? pending[i] : -1;
+    }
+    kernel->synchDisk->WriteSector(LogSector, (char *) header);
+    delete header;
+}
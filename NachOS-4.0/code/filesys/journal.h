@@ -0,0 +1,119 @@
+// journal.h
+//	Data structures for a write-ahead log of file system metadata.
+//
+//	Creating or removing a file changes several sectors -- the free
+//	map, the directory, and file headers -- and a crash between any
+//	two of those writes leaves the disk inconsistent.  So every sector
+//	written during a file system operation (between Begin and End) is
+//	first recorded in a transaction, and kept pinned in the sector
+//	cache, where it cannot be written back to its home location yet.
+//
+//	Many operations go into the same transaction.  It is committed,
+//	when it gets big enough (or when the cache is flushed), with one
+//	sequential write of all its sectors to a log at the end of the
+//	disk, followed by a header sector that names their home locations.
+//	Only then are the sectors unpinned, and written home whenever the
+//	cache gets around to it.  A sector changed by many operations is
+//	written home once, rather than once per operation.
+//
+//	The log holds one transaction.  Before the next one overwrites
+//	it, the last one is "checkpointed": whatever of it is not yet at
+//	home is written there, and the log is marked empty.
+//
+//	After a crash, Replay copies a committed transaction from the log
+//	to its home locations, when the disk is mounted.  Operations that
+//	were not yet committed are lost, but the disk is consistent.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "callback.h"
+
+class Semaphore;
+class Lock;
+
+// The log header fills one sector: three words, then the home
+// location of each logged sector.  The sectors themselves follow
+// the header on disk.
+
+#define MaxLogged 	((int)(SectorSize / sizeof(int)) - 3)
+#define LogSectors 	(MaxLogged + 1)
+#define LogSector 	(NumSectors - LogSectors)	// where the log starts
+
+// Commit at the end of an operation, once a transaction has this
+// many sectors; well short of MaxLogged, so that the next operation
+// is likely to fit.  The sector cache must have room for the pinned
+// sectors, and then some.
+
+#define CommitThreshold 	(MaxLogged / 2)
+
+class LogHeader {
+  public:
+    int magic;				// LogMagic, if the log was ever
+    					// written
+    int sequence;			// which transaction this is
+    int numSectors;			// how many sectors are logged, or
+    					// 0 if the log is empty
+    int sectors[MaxLogged];		// the home location of each one
+};
+
+// The following class defines the journal.  There is one, belonging
+// to the (real) file system, which hands it to kernel->sectorCache.
+
+class Journal : public CallBackObj {
+  public:
+    Journal();				// Initialize an empty transaction
+    ~Journal();
+
+    void Reset();			// Empty the log on disk, on a newly
+    					// formatted disk
+    void Replay();			// Redo a committed transaction left
+    					// in the log by a crash, then empty
+					// the log
+
+    void Begin();			// Start a file system operation;
+    					// may be nested.  Waits until no
+					// other thread is in one
+    void End();				// The operation is done; commit if
+    					// the transaction is big enough
+    bool Logging();			// Is the current thread in the
+    					// middle of an operation?
+
+    void Record(int sectorNumber, char *data);
+    					// A sector was written by the
+					// current operation
+    void Commit();			// Write the transaction to the log
+    void Checkpoint();			// Make sure the committed transaction
+    					// is at home, and empty the log
+
+    void CallBack();			// A log sector has been written
+
+  private:
+    Lock *lock;				// held by the thread whose operation
+    					// is in progress
+    int depth;				// how deeply Begin calls are nested
+    int sequence;			// number of the last transaction
+
+    int numPending;			// the open transaction: how many
+    int pending[MaxLogged];		// sectors, where they go,
+    char *pendingData;			// and their contents
+
+    int numCommitted;			// the last committed transaction,
+    int committed[MaxLogged];		// which may not be at home yet
+    char *committedData;
+
+    Semaphore *written;			// signalled as each log write
+    					// finishes
+
+    int Find(int sectorNumber, int *sectors, int count);
+    					// index of a sector in a transaction
+    void WriteHeader(int count);	// Write the log header
+};
+
+#endif // JOURNAL_H
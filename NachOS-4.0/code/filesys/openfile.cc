@@ -7,6 +7,24 @@
 //	Also as in UNIX, for convenience, we keep the file header in
 //	memory while the file is open.
 //
+//	Like the UNIX standard I/O library, Read and Write try to do 
+//	something smart about small requests.  When a file is read 
+//	sequentially, the next few sectors are prefetched, so that they
+//	are (probably) in the sector cache by the time they are needed.
+//	Small Writes are collected in a one-sector buffer, which is 
+//	written to the file, a whole sector at a time, when a Write goes
+//	elsewhere, before any ReadAt or WriteAt, and when the file is
+//	closed.  So bytes written through one OpenFile may not be seen
+//	through another OpenFile on the same file until then.
+//
+//	Writing at (or across) the end of the file makes it longer, 
+//	allocating data blocks several at a time.  The new length is kept
+//	in the in-memory file header, which is written back to disk only 
+//	when the file is closed (or Synced) -- not for every Write.  All
+//	the OpenFiles on a file share that header (see OpenHeader), and
+//	every open file is Synced before Nachos halts (see SyncAll), so
+//	no growth is lost, and no blocks leak.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -16,31 +34,85 @@
 #include "main.h"
 #include "filehdr.h"
 #include "openfile.h"
-#include "synchdisk.h"
+#include "sectorcache.h"
+#include "synch.h"
+
+// Every open file: to find the header of a file that is open already,
+// and to Sync them all before Nachos halts.
+static List<OpenFile *> *openFiles = NULL;
+
+//----------------------------------------------------------------------
+// OpenHeader::OpenHeader
+// 	Bring a file header into memory, for the first OpenFile on the 
+//	file.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+OpenHeader::OpenHeader(int sector)
+{
+    hdr = new FileHeader;
+    hdr->FetchFrom(sector);
+    this->sector = sector;
+    refCount = 0;
+    dirty = FALSE;
+    lock = new Lock("file header");
+}
+
+OpenHeader::~OpenHeader()
+{
+    delete hdr;
+    delete lock;
+}
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless the file is open
+//	already, in which case we share the header that is in memory.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    if (openFiles == NULL)
+	openFiles = new List<OpenFile *>;
+    header = NULL;
+    ListIterator<OpenFile *> iter(openFiles);
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->hdrSector == sector) {
+	    header = iter.Item()->header;
+	    break;
+	}
+    }
+    if (header == NULL)
+	header = new OpenHeader(sector);
+    header->refCount++;
+    openFiles->Append(this);
+
+    hdr = header->hdr;
+    hdrSector = sector;
     seekPosition = 0;
+    readAheadPosition = 0;
+    readAheadSector = 0;
+    writeBuffer = new char[SectorSize];
+    bufferedSector = -1;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The header goes when the last OpenFile on the file is closed.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    Sync();
+    openFiles->Remove(this);
+    if (--header->refCount == 0)
+	delete header;
+    delete [] writeBuffer;
 }
 
 //----------------------------------------------------------------------
@@ -63,7 +135,10 @@ OpenFile::Seek(int position)
 //	Return the number of bytes actually written or read, and as a
 //	side effect, increment the current position within the file.
 //
-//	Implemented using the more primitive ReadAt/WriteAt.
+//	Implemented using the more primitive ReadAt/WriteAt.  A Read that
+//	continues where the last one left off starts a read-ahead.  A Write
+//	that fits in one sector goes into writeBuffer instead, unless it is 
+//	not next to the bytes already there.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -74,16 +149,133 @@ int
 OpenFile::Read(char *into, int numBytes)
 {
    int result = ReadAt(into, numBytes, seekPosition);
+
+   if (seekPosition == readAheadPosition) {
+       ReadAhead(seekPosition + result);
+   } else {
+       readAheadSector = 0;		// start over
+   }
    seekPosition += result;
+   readAheadPosition = seekPosition;
    return result;
 }
 
 int
 OpenFile::Write(char *into, int numBytes)
 {
-   int result = WriteAt(into, numBytes, seekPosition);
-   seekPosition += result;
-   return result;
+   int fileLength = hdr->FileLength();
+   int sector, offset, result;
+
+   if ((numBytes <= 0) || (seekPosition > fileLength))
+       return 0;				// check request
+   if ((seekPosition + numBytes) > fileLength && !Grow(seekPosition + numBytes))
+       numBytes = fileLength - seekPosition;	// disk is full
+   if (numBytes <= 0)
+       return 0;
+
+   sector = divRoundDown(seekPosition, SectorSize);
+   offset = seekPosition - (sector * SectorSize);
+   if (offset + numBytes > SectorSize) {	// big enough already
+       result = WriteAt(into, numBytes, seekPosition);
+       seekPosition += result;
+       return result;
+   }
+
+   if (sector != bufferedSector || offset > dirtyTo 
+		|| offset + numBytes < dirtyFrom) {
+       FlushWrites();
+       bufferedSector = sector;
+       dirtyFrom = dirtyTo = offset;
+   }
+   bcopy(into, &writeBuffer[offset], numBytes);
+   dirtyFrom = min(dirtyFrom, offset);
+   dirtyTo = max(dirtyTo, offset + numBytes);
+   seekPosition += numBytes;
+   return numBytes;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Grow
+// 	Make the file at least "fileSize" bytes long, allocating data 
+//	blocks for it if it does not have room.  The header is written 
+//	back later.
+//
+//	Extend may wait for the disk, so another OpenFile on the same file
+//	could start growing it too; the header's lock makes it wait, and
+//	then see the blocks we allocated.
+//
+//	Return FALSE if the disk is full.
+//
+//	"fileSize" -- the new length of the file
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Grow(int fileSize)
+{
+    bool success = TRUE;
+
+    header->lock->Acquire();
+    if (fileSize > hdr->FileLength()) {
+	if (fileSize > hdr->Capacity() 
+		&& !kernel->fileSystem->Extend(hdr, fileSize))
+	    success = FALSE;
+	else {
+	    hdr->SetLength(fileSize);
+	    header->dirty = TRUE;
+	}
+    }
+    header->lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Prefetch the sectors following "position" into the sector cache,
+//	for a sequential reader, skipping those we already asked for.
+//
+//	"position" -- where the reader will continue
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int position)
+{
+    int numSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int first = divRoundDown(position, SectorSize);
+    int last = min(first + ReadAheadSectors, numSectors);
+
+    for (int i = max(first, readAheadSector); i < last; i++) {
+	kernel->sectorCache->Prefetch(hdr->ByteToSector(i * SectorSize));
+    }
+    readAheadSector = max(readAheadSector, last);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::FlushWrites
+// 	Write the bytes collected by Write to the file.  If they do not 
+//	cover the whole sector, the rest of the sector has to be read 
+//	first -- once, rather than for every small Write.
+//----------------------------------------------------------------------
+
+void
+OpenFile::FlushWrites()
+{
+    int sector;
+    char *old;
+
+    if (bufferedSector == -1)
+	return;
+    DEBUG(dbgFile, "Flushing bytes " << dirtyFrom << " to " << dirtyTo
+		<< " of sector " << bufferedSector);
+    sector = hdr->ByteToSector(bufferedSector * SectorSize);
+    if (dirtyFrom != 0 || dirtyTo != SectorSize) {
+	old = new char[SectorSize];
+	kernel->sectorCache->ReadSector(sector, old);
+	bcopy(old, writeBuffer, dirtyFrom);
+	bcopy(&old[dirtyTo], &writeBuffer[dirtyTo], SectorSize - dirtyTo);
+	delete [] old;
+    }
+    kernel->sectorCache->WriteSector(sector, writeBuffer);
+    bufferedSector = -1;
 }
 
 //----------------------------------------------------------------------
@@ -103,7 +295,9 @@ OpenFile::Write(char *into, int numBytes)
 //	   We must first read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
 //	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   or partial sectors that are part of the request.  A write that
+//	   goes past the end of the file makes the file longer; one that 
+//	   starts past the end (leaving a hole) is refused.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -119,6 +313,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     int i, firstSector, lastSector, numSectors;
     char *buf;
 
+    FlushWrites();				// so that we see them
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
     if ((position + numBytes) > fileLength)		
@@ -132,7 +327,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
     for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+        kernel->sectorCache->ReadSector(hdr->ByteToSector(i * SectorSize), 
 					&buf[(i - firstSector) * SectorSize]);
 
     // copy the part we want
@@ -149,10 +344,14 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     bool firstAligned, lastAligned;
     char *buf;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    FlushWrites();				// keep writes in order
+    if ((numBytes <= 0) || (position > fileLength))
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if ((position + numBytes) > fileLength && !Grow(position + numBytes))
+	numBytes = fileLength - position;	// disk is full
+    if (numBytes <= 0)
+	return 0;
+    fileLength = hdr->FileLength();
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
@@ -176,7 +375,7 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // write modified sectors back
     for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
+        kernel->sectorCache->WriteSector(hdr->ByteToSector(i * SectorSize), 
 					&buf[(i - firstSector) * SectorSize]);
     delete [] buf;
     return numBytes;
@@ -193,4 +392,50 @@ OpenFile::Length()
     return hdr->FileLength(); 
 }
 
+//----------------------------------------------------------------------
+// OpenFile::Sync
+// 	Write any bytes still buffered by Write to the file, and the file
+//	header to disk if the file has grown, as if the file were closed.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Sync()
+{
+    FlushWrites();
+    if (header->dirty) {
+	header->dirty = FALSE;
+	kernel->fileSystem->WriteHeader(hdr, hdrSector);
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::SyncAll
+// 	Sync every open file, so that nothing written to them is lost 
+//	when Nachos halts.
+//
+//	A Sync may wait for the disk, and other threads may open or close
+//	files meanwhile, so we look for the next file that needs it from
+//	the start of the list every time.
+//----------------------------------------------------------------------
+
+void
+OpenFile::SyncAll()
+{
+    OpenFile *file;
+
+    do {
+	file = NULL;
+	if (openFiles != NULL) {
+	    ListIterator<OpenFile *> iter(openFiles);
+	    for (; !iter.IsDone() && file == NULL; iter.Next()) {
+		if (iter.Item()->bufferedSector != -1 
+			|| iter.Item()->header->dirty)
+		    file = iter.Item();
+	    }
+	}
+	if (file != NULL)
+	    file->Sync();
+    } while (file != NULL);
+}
+
 #endif //FILESYS_STUB
@@ -105,6 +105,9 @@ public:
         return name;
     }
 
+    // the same number for the same file, whatever name it was opened by
+    int Identity() { return FileIdentity(file); }
+
     int Length() { Lseek(file, 0, 2); return Tell(file); }
 
 private:
@@ -114,6 +117,27 @@ private:
 
 #else // FILESYS
 class FileHeader;
+class Lock;
+
+const int ReadAheadSectors = 4;		// how far ahead of a sequential
+					// reader to prefetch
+
+// The in-memory copy of the header of an open file.  All the OpenFiles
+// on a file share one, so that they all see the file grow, and only
+// one of them grows it at a time.
+
+class OpenHeader {
+  public:
+    OpenHeader(int sector);		// Read a file header into memory
+    ~OpenHeader();			// De-allocate it
+
+    FileHeader *hdr;			// the file header
+    int sector;				// where it is on disk
+    int refCount;			// how many OpenFiles share it
+    bool dirty;				// has the file grown since the
+    					// header was written to disk?
+    Lock *lock;				// held while the file grows
+};
 
 class OpenFile {
 public:
@@ -140,9 +164,35 @@ public:
                     // than the UNIX idiom -- lseek to 
                     // end of file, tell, lseek back 
 
+    int Identity() { return hdrSector; }
+    					// The same number for the same
+					// file, whatever its name: where
+					// its header is
+
+    void Sync();			// Write buffered bytes, and the file
+                    // header if it changed, to disk --
+                    // UNIX fsync
+    static void SyncAll();		// Sync every open file
+
 private:
-    FileHeader* hdr;			// Header for this file 
+    OpenHeader* header;			// Header for this file, shared with
+    					// other OpenFiles on the same file
+    FileHeader* hdr;			// header->hdr
+    int hdrSector;			// Where the header is on disk
     int seekPosition;			// Current position within the file
+    bool Grow(int fileSize);		// Make the file longer
+
+    int readAheadPosition;		// Where the next Read starts, if 
+    					// the file is being read sequentially
+    int readAheadSector;		// The first sector not prefetched yet
+    void ReadAhead(int position);	// Prefetch the sectors after position
+
+    char* writeBuffer;			// Bytes written by Write, but not yet
+    					// to the file
+    int bufferedSector;			// Which sector of the file they are 
+    					// in, or -1 if there are none
+    int dirtyFrom, dirtyTo;		// Which bytes of writeBuffer they are
+    void FlushWrites();			// Write writeBuffer to the file
 };
 
 #endif // FILESYS
@@ -0,0 +1,391 @@
+// sectorcache.cc
+//	Routines to keep recently used disk sectors in memory.
+//
+//	The cache is protected by a lock, which is not held while a
+//	sector is being read or written, so that other threads can use
+//	the cache (and the disk) meanwhile.  Instead, an entry being read
+//	or written is marked busy, and anybody who needs it waits on a
+//	condition variable until it is not.
+//
+//	A prefetched sector is read asynchronously, and the disk calls
+//	back from its interrupt handler, where we cannot take the lock.
+//	So the entry stays busy until some thread that needs it (or its
+//	slot) waits for the read to finish, and then marks it not busy.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "sectorcache.h"
+#include "synchdisk.h"
+#include "journal.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// CacheEntry::CallBack
+// 	Disk interrupt handler, for a prefetch of the entry's sector.
+//	Wake up whoever waits for it, or will.
+//----------------------------------------------------------------------
+
+void
+CacheEntry::CallBack()
+{
+    arrived->V();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::SectorCache
+// 	Initialize the sector cache; no sector is cached yet.
+//----------------------------------------------------------------------
+
+SectorCache::SectorCache()
+{
+    lruList = new List<CacheEntry *>;
+    for (int i = 0; i < NumCacheSectors; i++) {
+	entries[i].sector = -1;
+	entries[i].dirty = FALSE;
+	entries[i].busy = FALSE;
+	entries[i].pinned = FALSE;
+	entries[i].prefetching = FALSE;
+	entries[i].arrived = new Semaphore("sector cache prefetch", 0);
+	lruList->Append(&entries[i]);
+    }
+    lock = new Lock("sector cache");
+    ioDone = new Condition("sector cache I/O");
+    journal = NULL;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::~SectorCache
+// 	De-allocate the sector cache.  Dirty sectors are lost; call Flush
+//	first to keep them.
+//----------------------------------------------------------------------
+
+SectorCache::~SectorCache()
+{
+    for (int i = 0; i < NumCacheSectors; i++) {
+	delete entries[i].arrived;
+    }
+    delete lruList;
+    delete lock;
+    delete ioDone;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::ReadSector
+// 	Read the contents of a disk sector into a buffer, from the cache
+//	if possible, otherwise from the disk (and keep it in the cache).
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+SectorCache::ReadSector(int sectorNumber, char *data)
+{
+    CacheEntry *entry;
+
+    lock->Acquire();
+    entry = Get(sectorNumber, FALSE);
+    bcopy(entry->data, data, SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::WriteSector
+// 	Write the contents of a buffer into a disk sector.  Only the cached
+//	copy is changed; the disk is written when the sector is evicted,
+//	or flushed.  A sector that is not cached does not need to be read
+//	first, since all of it is overwritten.
+//
+//	If a file system operation is in progress, the write is part of
+//	it: the journal gets a copy, and the sector is pinned until the
+//	journal commits it.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+SectorCache::WriteSector(int sectorNumber, char *data)
+{
+    CacheEntry *entry;
+    bool logged = (journal != NULL && journal->Logging());
+
+    lock->Acquire();
+    entry = Get(sectorNumber, TRUE);
+    bcopy(data, entry->data, SectorSize);
+    entry->dirty = TRUE;
+    if (logged)
+	entry->pinned = TRUE;
+    lock->Release();
+
+    if (logged)				// the journal may use the cache, too
+	journal->Record(sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Prefetch
+// 	Start reading a sector into the cache, and return without waiting
+//	for it.  This is only a hint: nothing happens if the sector is
+//	already cached, or if making room for it would mean waiting for
+//	the disk.
+//
+//	"sectorNumber" -- the disk sector that will be needed soon
+//----------------------------------------------------------------------
+
+void
+SectorCache::Prefetch(int sectorNumber)
+{
+    CacheEntry *entry = NULL;
+
+    lock->Acquire();
+    if (Find(sectorNumber) != NULL) {
+	lock->Release();
+	return;
+    }
+    ListIterator<CacheEntry *> iter(lruList);
+    for (; !iter.IsDone(); iter.Next()) {
+	if (!iter.Item()->busy && !iter.Item()->dirty) {
+	    entry = iter.Item();
+	    break;
+	}
+    }
+    if (entry != NULL) {
+	DEBUG(dbgDisk, "Cache prefetching sector " << sectorNumber);
+	entry->sector = sectorNumber;
+	entry->busy = TRUE;
+	entry->prefetching = TRUE;
+	lruList->Remove(entry);
+	lruList->Append(entry);
+	kernel->synchDisk->ReadRequest(sectorNumber, entry->data, entry);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Flush
+// 	Write every dirty sector back to disk.  The sectors stay cached.
+//	The journal commits whatever it has first, so that nothing is 
+//	pinned (unless an operation is in progress), and then, since 
+//	everything is at home, it can empty its log.
+//----------------------------------------------------------------------
+
+void
+SectorCache::Flush()
+{
+    bool again;
+
+    if (journal != NULL)
+	journal->Commit();
+    lock->Acquire();
+    do {
+	again = FALSE;
+	for (int i = 0; i < NumCacheSectors; i++) {
+	    if (entries[i].busy) {
+		Wait(&entries[i]);
+		again = TRUE;		// things may have changed meanwhile
+		break;
+	    }
+	    if (entries[i].dirty && !entries[i].pinned) {
+		WriteBack(&entries[i]);
+		again = TRUE;
+		break;
+	    }
+	}
+    } while (again);
+    lock->Release();
+    if (journal != NULL)
+	journal->Checkpoint();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Flush
+// 	Write one sector back to disk, if it is cached and dirty, and not
+//	pinned.  Used by the journal to checkpoint.
+//
+//	"sectorNumber" -- the sector to write back
+//----------------------------------------------------------------------
+
+void
+SectorCache::Flush(int sectorNumber)
+{
+    CacheEntry *entry;
+
+    lock->Acquire();
+    for (;;) {
+	entry = Find(sectorNumber);
+	if (entry == NULL || !entry->busy)
+	    break;
+	Wait(entry);
+    }
+    if (entry != NULL && entry->dirty && !entry->pinned)
+	WriteBack(entry);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Unpin
+// 	The journal has committed a sector to its log, so it may be 
+//	written back now, like any other dirty sector.
+//
+//	"sectorNumber" -- the committed sector
+//----------------------------------------------------------------------
+
+void
+SectorCache::Unpin(int sectorNumber)
+{
+    CacheEntry *entry;
+
+    lock->Acquire();
+    entry = Find(sectorNumber);
+    if (entry != NULL)
+	entry->pinned = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Find
+// 	Return the entry holding a sector, or NULL if it is not cached.
+//	The cache must be locked.
+//
+//	"sectorNumber" -- the sector to look for
+//----------------------------------------------------------------------
+
+CacheEntry *
+SectorCache::Find(int sectorNumber)
+{
+    for (int i = 0; i < NumCacheSectors; i++) {
+	if (entries[i].sector == sectorNumber) {
+	    return &entries[i];
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Get
+// 	Return the (not busy) entry holding a sector, making it the most
+//	recently used one.  If the sector is not cached, the least recently
+//	used entry that is not busy (or pinned) is reused for it, after
+//	writing it back if it is dirty.
+//
+//	The cache must be locked; the lock is released while waiting for
+//	the disk, so the search starts over after every wait.
+//
+//	"sectorNumber" -- the sector we want
+//	"overwrite" -- if TRUE, the caller is about to overwrite the whole
+//		sector, so there is no need to read it from disk
+//----------------------------------------------------------------------
+
+CacheEntry *
+SectorCache::Get(int sectorNumber, bool overwrite)
+{
+    CacheEntry *entry;
+
+    ASSERT(lock->IsHeldByCurrentThread());
+
+    for (;;) {
+	entry = Find(sectorNumber);
+	if (entry != NULL) {
+	    if (entry->busy) {
+		Wait(entry);
+		continue;
+	    }
+	    kernel->stats->numCacheHits++;
+	    break;
+	}
+
+	entry = NULL;
+	ListIterator<CacheEntry *> iter(lruList);
+	for (; !iter.IsDone(); iter.Next()) {
+	    if (!iter.Item()->busy && !iter.Item()->pinned) {
+		entry = iter.Item();
+		break;
+	    }
+	}
+	if (entry == NULL) {		// everything is busy
+	    ListIterator<CacheEntry *> busy(lruList);
+	    while (!busy.Item()->busy)	// the journal pins only a few 
+		busy.Next();		// entries, so some are busy
+	    Wait(busy.Item());
+	    continue;
+	}
+	if (entry->dirty) {
+	    WriteBack(entry);
+	    continue;
+	}
+
+	DEBUG(dbgDisk, "Cache miss on sector " << sectorNumber);
+	kernel->stats->numCacheMisses++;
+	entry->sector = sectorNumber;
+	if (!overwrite) {
+	    entry->busy = TRUE;
+	    lock->Release();
+	    kernel->synchDisk->ReadSector(sectorNumber, entry->data);
+	    lock->Acquire();
+	    entry->busy = FALSE;
+	    ioDone->Broadcast(lock);
+	}
+	break;
+    }
+
+    lruList->Remove(entry);
+    lruList->Append(entry);
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// SectorCache::WriteBack
+// 	Write a dirty entry to disk.  The entry is busy meanwhile, so 
+//	nobody changes it under our feet.
+//
+//	The cache must be locked; the lock is released during the write.
+//
+//	"entry" -- the entry to write back
+//----------------------------------------------------------------------
+
+void
+SectorCache::WriteBack(CacheEntry *entry)
+{
+    ASSERT(entry->dirty && !entry->busy);
+
+    DEBUG(dbgDisk, "Cache writing back sector " << entry->sector);
+    entry->busy = TRUE;
+    entry->dirty = FALSE;
+    lock->Release();
+    kernel->synchDisk->WriteSector(entry->sector, entry->data);
+    lock->Acquire();
+    entry->busy = FALSE;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SectorCache::Wait
+// 	Wait until a busy entry is no longer busy.  If it is being 
+//	prefetched, and nobody is waiting for that yet, we wait for the
+//	disk ourselves, and then wake up everybody else.
+//
+//	The cache must be locked; the lock is released while waiting.
+//
+//	"entry" -- the busy entry
+//----------------------------------------------------------------------
+
+void
+SectorCache::Wait(CacheEntry *entry)
+{
+    ASSERT(entry->busy);
+
+    if (!entry->prefetching) {
+	ioDone->Wait(lock);
+	return;
+    }
+    entry->prefetching = FALSE;
+    lock->Release();
+    entry->arrived->P();
+    lock->Acquire();
+    entry->busy = FALSE;
+    ioDone->Broadcast(lock);
+}
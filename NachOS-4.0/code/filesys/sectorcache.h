@@ -0,0 +1,106 @@
+// sectorcache.h
+//	Data structures to keep recently used disk sectors in memory.
+//
+//	The file system reads the same few sectors -- the free map, the
+//	directory, and the headers of open files -- over and over.  The
+//	sector cache sits between the file system and the synchronous
+//	disk, so that these reads (and most writes) do not go to the disk
+//	at all.
+//
+//	Writes are "write-back": a cached sector is only marked dirty, and
+//	written to disk when it is evicted to make room for another sector,
+//	or when Nachos halts (see Interrupt::Halt).  When the cache is full,
+//	the sector used least recently is evicted.
+//
+//	A sector can also be prefetched: read into the cache in the 
+//	background, because somebody expects to need it soon (see
+//	OpenFile::Read).
+//
+//	Once the file system is mounted, sectors written by file system
+//	operations are also recorded in its journal, and pinned: they stay
+//	in the cache, and are not written back, until the journal has
+//	committed them to its log (see journal.h).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SECTORCACHE_H
+#define SECTORCACHE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "list.h"
+#include "callback.h"
+
+class Lock;
+class Condition;
+class Semaphore;
+class Journal;
+
+const int NumCacheSectors = 64;		// sectors kept in memory
+
+// The following class defines one cached sector.  It is called back
+// by the disk when a prefetch of the sector is done.
+
+class CacheEntry : public CallBackObj {
+  public:
+    int sector;				// which sector is here, or -1
+    bool dirty;				// modified since read from disk?
+    bool busy;				// being read or written right now?
+    bool pinned;			// must not be written back, until the
+    					// journal commits it?
+    bool prefetching;			// being prefetched, and nobody has
+    					// waited for it yet?
+    Semaphore *arrived;			// signalled when a prefetch is done
+    char data[SectorSize];		// the contents of the sector
+
+    void CallBack();			// The prefetch is done
+};
+
+// The following class defines the sector cache.  There is only one,
+// kernel->sectorCache; all file system access to the disk should go
+// through it, rather than straight to kernel->synchDisk, or it will
+// see stale data.
+
+class SectorCache {
+  public:
+    SectorCache();			// Initialize an empty cache
+    ~SectorCache();			// De-allocate the cache; does not
+    					// write back dirty sectors
+
+    void ReadSector(int sectorNumber, char *data);
+    					// Read a sector, from the cache if 
+					// it is there
+    void WriteSector(int sectorNumber, char *data);
+    					// Write a sector into the cache; it
+					// goes to disk later
+    void Prefetch(int sectorNumber);	// Start reading a sector into the
+    					// cache, without waiting for it
+    void Flush();			// Write every dirty sector to disk
+    void Flush(int sectorNumber);	// Write one sector, if it is dirty
+
+    void SetJournal(Journal *log) { journal = log; }
+    					// Record writes in a journal, from
+					// now on
+    void Unpin(int sectorNumber);	// The journal has committed a sector
+
+  private:
+    CacheEntry entries[NumCacheSectors];
+    List<CacheEntry *> *lruList;	// the entries, least recently used
+    					// first
+    Lock *lock;				// protects the cache
+    Condition *ioDone;			// signalled when an entry stops
+    					// being busy
+    Journal *journal;			// the file system's journal, or NULL
+
+    CacheEntry *Find(int sectorNumber);	// Return the entry holding a
+    					// sector, or NULL
+    CacheEntry *Get(int sectorNumber, bool overwrite);
+    					// Return the entry holding a sector,
+					// reading it in if need be
+    void WriteBack(CacheEntry *entry);	// Write a dirty entry to disk
+    void Wait(CacheEntry *entry);	// Wait until a busy entry is not
+};
+
+#endif // SECTORCACHE_H
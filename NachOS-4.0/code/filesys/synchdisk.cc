@@ -3,12 +3,16 @@
 //	is an asynchronous device (disk requests return immediately, and
 //	an interrupt happens later on).  This is a layer on top of
 //	the disk providing a synchronous interface (requests wait until
-//	the request completes).
+//	the request completes), as well as an asynchronous one that 
+//	accepts any number of requests at once.
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Because the physical disk can only handle one operation at a time,
+//	requests are kept on a queue, and the interrupt handler starts the
+//	next one when the disk finishes with the previous one.  The queue
+//	is shared with the interrupt handler, so it is protected by 
+//	disabling interrupts rather than with a lock.  A thread waiting
+//	for its request to finish waits on a semaphore, which is signalled
+//	by the request's callback.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,7 +20,41 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "main.h"
 
+// The following class is the callback for a ReadSector or WriteSector
+// request: it wakes up the thread waiting for the request.
+
+class DiskWaiter : public CallBackObj {
+  public:
+    DiskWaiter() { done = new Semaphore("synch disk", 0); }
+    ~DiskWaiter() { delete done; }
+
+    void Wait() { done->P(); }		// wait for the request
+    void CallBack() { done->V(); }	// the request is done
+
+  private:
+    Semaphore *done;
+};
+
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Initialize a request to read or write a disk sector.
+//
+//	"sector" -- the disk sector to read or write
+//	"buffer" -- the data to read into, or to write
+//	"isWrite" -- TRUE for a write
+//	"callWhenDone" -- the object to call back when the request is done
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int sector, char *buffer, bool isWrite, 
+			CallBackObj *callWhenDone)
+{
+    sectorNumber = sector;
+    data = buffer;
+    writing = isWrite;
+    whenDone = callWhenDone;
+}
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
@@ -27,8 +65,9 @@
 
 SynchDisk::SynchDisk()
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    queue = new List<DiskRequest *>;
+    current = NULL;
+    headSector = 0;
     disk = new Disk(this);
 }
 
@@ -41,8 +80,13 @@ SynchDisk::SynchDisk()
 SynchDisk::~SynchDisk()
 {
     delete disk;
-    delete lock;
-    delete semaphore;
+    while (!queue->IsEmpty()) {
+	delete queue->RemoveFront();
+    }
+    delete queue;
+    if (current != NULL) {
+	delete current;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -57,10 +101,10 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskWaiter waiter;
+
+    ReadRequest(sectorNumber, data, &waiter);
+    waiter.Wait();			// wait for interrupt
 }
 
 //----------------------------------------------------------------------
@@ -75,20 +119,118 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskWaiter waiter;
+
+    WriteRequest(sectorNumber, data, &waiter);
+    waiter.Wait();			// wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadRequest, SynchDisk::WriteRequest
+// 	Queue a request to read (or write) a disk sector, and return
+//	without waiting for it.  "data" must stay around until the
+//	request is done.
+//
+//	"sectorNumber" -- the disk sector to read or write
+//	"data" -- the buffer to read into, or to write from
+//	"whenDone" -- whenDone->CallBack() is called, from the disk
+//		interrupt handler, when the request is done
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadRequest(int sectorNumber, char* data, CallBackObj *whenDone)
+{
+    Enqueue(new DiskRequest(sectorNumber, data, FALSE, whenDone));
+}
+
+void
+SynchDisk::WriteRequest(int sectorNumber, char* data, CallBackObj *whenDone)
+{
+    Enqueue(new DiskRequest(sectorNumber, data, TRUE, whenDone));
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Enqueue
+// 	Put a request on the queue.  If the disk has nothing to do, 
+//	start it right away.
+//
+//	"request" -- the request
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Enqueue(DiskRequest *request)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT((request->sectorNumber >= 0) 
+		&& (request->sectorNumber < NumSectors));
+    DEBUG(dbgDisk, "Queueing " << (request->writing ? "write" : "read") 
+		<< " of sector " << request->sectorNumber);
+    queue->Append(request);
+    if (current == NULL) {
+	StartNext();
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Send the next request to the disk, if there is one.  Requests are
+//	served in C-LOOK order: the first request at or beyond the sector
+//	the head was last sent to, or if there is none, the first request
+//	overall.  Requests for the same sector are served in the order 
+//	they were made, so a read after a write sees the new data.
+//
+//	Called with interrupts disabled, when the disk is idle.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    DiskRequest *ahead = NULL, *lowest = NULL;
+
+    ASSERT(current == NULL);
+    if (queue->IsEmpty()) {
+	return;
+    }
+
+    ListIterator<DiskRequest *> iter(queue);
+    for (; !iter.IsDone(); iter.Next()) {
+	DiskRequest *request = iter.Item();
+
+	if (request->sectorNumber >= headSector && (ahead == NULL 
+		|| request->sectorNumber < ahead->sectorNumber)) {
+	    ahead = request;
+	}
+	if (lowest == NULL || request->sectorNumber < lowest->sectorNumber) {
+	    lowest = request;
+	}
+    }
+    current = (ahead != NULL) ? ahead : lowest;
+    queue->Remove(current);
+    headSector = current->sectorNumber;
+
+    if (current->writing) {
+	disk->WriteRequest(current->sectorNumber, current->data);
+    } else {
+	disk->ReadRequest(current->sectorNumber, current->data);
+    }
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Start the disk on the next request, and
+//	let whoever made the one that just finished know it is done.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::CallBack()
 { 
-    semaphore->V();
+    DiskRequest *done = current;
+
+    ASSERT(done != NULL);
+    current = NULL;
+    StartNext();
+    done->whenDone->CallBack();
+    delete done;
 }
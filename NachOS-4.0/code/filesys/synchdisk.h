@@ -14,6 +14,22 @@
 #include "disk.h"
 #include "synch.h"
 #include "callback.h"
+#include "list.h"
+
+// The following class defines a request to read or write one sector,
+// waiting its turn to be sent to the disk.
+
+class DiskRequest {
+  public:
+    DiskRequest(int sector, char *buffer, bool isWrite, 
+    		CallBackObj *callWhenDone);
+
+    int sectorNumber;			// the sector to read or write
+    char *data;				// the data to read into, or write
+    bool writing;			// is this a write?
+    CallBackObj *whenDone;		// called (from the disk interrupt
+    					// handler) when the request is done
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -22,9 +38,16 @@
 // (Also, the physical characteristics of the disk device assume that
 // only one operation can be requested at a time).
 //
-// This class provides the abstraction that for any individual thread
-// making a request, it waits around until the operation finishes before
-// returning.
+// This class queues up requests from any number of threads, and sends
+// them to the disk one at a time, in C-LOOK order: the head sweeps
+// towards higher sectors, serving the nearest request ahead of it,
+// and jumps back to the lowest one when there are none left ahead.
+// This keeps seeks short when many threads use the disk at once.
+//
+// ReadRequest and WriteRequest return at once, and call back when the
+// request is done.  For any individual thread making a request with
+// ReadSector or WriteSector, it waits around until the operation 
+// finishes before returning.
 
 class SynchDisk : public CallBackObj {
   public:
@@ -35,10 +58,16 @@ class SynchDisk : public CallBackObj {
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+					// or written.  These queue a request
+					// and then wait until it is done.
     void WriteSector(int sectorNumber, char* data);
+
+    void ReadRequest(int sectorNumber, char* data, CallBackObj *whenDone);
+    void WriteRequest(int sectorNumber, char* data, CallBackObj *whenDone);
+    					// Queue a request to read/write a 
+					// disk sector, and return at once; 
+					// whenDone->CallBack() is called 
+					// when the request is done
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -46,10 +75,17 @@ class SynchDisk : public CallBackObj {
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    List<DiskRequest *> *queue;		// Requests waiting for the disk,
+    					// in the order they were made
+    DiskRequest *current;		// The request the disk is working on,
+    					// or NULL if it is idle
+    int headSector;			// The sector of the last request sent
+					// to the disk
+
+    void Enqueue(DiskRequest *request);	// Queue a request, and start it
+    					// if the disk is idle
+    void StartNext();			// Send the next request, in C-LOOK 
+    					// order, to the disk
 };
 
 #endif // SYNCHDISK_H
@@ -2,6 +2,13 @@
 //	Routines to manage a bitmap -- an array of bits each of which
 //	can be either on or off.  Represented as an array of integers.
 //
+//	Searches skip over whole words at a time: a word with no clear bit
+//	is all ones, and within a word, the compiler's "count trailing 
+//	zeroes" builtin finds the first clear bit in one instruction on 
+//	most machines.  Besides, we remember how many bits are clear, and
+//	a "hint" -- no bit before it is clear -- so that FindAndSet does
+//	not scan the part of the bitmap it has already filled up.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -30,9 +37,8 @@ Bitmap::Bitmap(int numItems)
     for (i = 0; i < numWords; i++) {
 	map[i] = 0;		// initialize map to keep Purify happy
     }
-    for (i = 0; i < numBits; i++) {
-        Clear(i);
-    }
+    numClear = numBits;
+    nextFree = 0;
 }
 
 //----------------------------------------------------------------------
@@ -57,7 +63,10 @@ Bitmap::Mark(int which)
 { 
     ASSERT(which >= 0 && which < numBits);
 
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    if (!Test(which)) {
+	map[which / BitsInWord] |= 1U << (which % BitsInWord);
+	numClear--;
+    }
 
     ASSERT(Test(which));
 }
@@ -74,7 +83,13 @@ Bitmap::Clear(int which)
 {
     ASSERT(which >= 0 && which < numBits);
 
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (Test(which)) {
+	map[which / BitsInWord] &= ~(1U << (which % BitsInWord));
+	numClear++;
+	if (which < nextFree) {
+	    nextFree = which;
+	}
+    }
 
     ASSERT(!Test(which));
 }
@@ -91,7 +106,7 @@ Bitmap::Test(int which) const
 {
     ASSERT(which >= 0 && which < numBits);
     
-    if (map[which / BitsInWord] & (1 << (which % BitsInWord))) {
+    if (map[which / BitsInWord] & (1U << (which % BitsInWord))) {
 	return TRUE;
     } else {
 	return FALSE;
@@ -110,15 +125,126 @@ Bitmap::Test(int which) const
 int 
 Bitmap::FindAndSet() 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    int which;
+
+    if (numClear == 0) {
+	return -1;
+    }
+    which = NextClear(nextFree);
+    ASSERT(which != -1);
+    Mark(which);
+    nextFree = which + 1;
+    return which;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindRun
+// 	Return the number of the first bit of the first run of "count"
+//	clear bits in a row.  If there is no such run, return -1.
+//
+//	"count" is the number of bits needed
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindRun(int count) const
+{
+    int start, end;
+
+    ASSERT(count > 0);
+
+    if (count > numClear) {
+	return -1;
+    }
+    start = NextClear(nextFree);
+    while (start != -1 && start + count <= numBits) {
+	end = NextSet(start);
+	if (end - start >= count) {
+	    return start;
+	}
+	start = NextClear(end);
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetRun
+// 	Find the first run of "count" clear bits in a row, and set them
+//	all.  (In other words, allocate "count" contiguous bits.)
+//	Return the number of the first bit, or -1 if there is no run.
+//
+//	"count" is the number of bits needed
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindAndSetRun(int count)
+{
+    int start = FindRun(count);
+
+    if (start == -1) {
+	return -1;
+    }
+    for (int i = start; i < start + count; i++) {
+	Mark(i);
+    }
+    if (start == nextFree) {
+	nextFree = start + count;
+    }
+    return start;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::NextClear
+// 	Return the number of the first clear bit at or after bit "which",
+//	or -1 if there is none.
+//
+//	"which" is where to start looking
+//----------------------------------------------------------------------
+
+int
+Bitmap::NextClear(int which) const
+{
+    ASSERT(which >= 0);
+
+    for (int w = which / BitsInWord; w < numWords; w++) {
+	unsigned int clear = ~map[w];
+
+	if (w == which / BitsInWord) {
+	    clear &= ~0U << (which % BitsInWord);	// ignore earlier bits
+	}
+	if (clear != 0) {
+	    which = w * BitsInWord + __builtin_ctz(clear);
+	    return (which < numBits) ? which : -1;
 	}
     }
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Bitmap::NextSet
+// 	Return the number of the first set bit at or after bit "which",
+//	or numBits if there is none.
+//
+//	"which" is where to start looking
+//----------------------------------------------------------------------
+
+int
+Bitmap::NextSet(int which) const
+{
+    ASSERT(which >= 0);
+
+    for (int w = which / BitsInWord; w < numWords; w++) {
+	unsigned int set = map[w];
+
+	if (w == which / BitsInWord) {
+	    set &= ~0U << (which % BitsInWord);	// ignore earlier bits
+	}
+	if (set != 0) {
+	    return min(w * BitsInWord + __builtin_ctz(set), numBits);
+	}
+    }
+    return numBits;
+}
+
 //----------------------------------------------------------------------
 // Bitmap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -128,14 +254,27 @@ Bitmap::FindAndSet()
 int 
 Bitmap::NumClear() const
 {
-    int count = 0;
+    return numClear;
+}
 
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    count++;
-	}
+//----------------------------------------------------------------------
+// Bitmap::Recount
+// 	Recompute the number of clear bits, and start the hint over, after
+//	the contents of "map" have been replaced (for instance, read from 
+//	disk).  Bits past the end of the bitmap are cleared, just in case.
+//----------------------------------------------------------------------
+
+void
+Bitmap::Recount()
+{
+    if (numBits % BitsInWord != 0) {
+	map[numWords - 1] &= (1U << (numBits % BitsInWord)) - 1;
     }
-    return count;
+    numClear = numBits;
+    for (int w = 0; w < numWords; w++) {
+	numClear -= __builtin_popcount(map[w]);
+    }
+    nextFree = 0;
 }
 
 //----------------------------------------------------------------------
@@ -181,11 +320,25 @@ Bitmap::SelfTest()
     Clear(1);
     Clear(31);
 
+    ASSERT(numBits >= 2 * BitsInWord);	// runs across words
+    Mark(2);
+    ASSERT(FindAndSetRun(BitsInWord) == 3);
+    ASSERT(NumClear() == numBits - BitsInWord - 1);
+    ASSERT(FindAndSet() == 0);
+    ASSERT(NextClear(3) == BitsInWord + 3);
+    ASSERT(FindRun(numBits) == -1);
+    for (i = 0; i < numBits; i++) {
+        Clear(i);
+    }
+    ASSERT(FindRun(numBits) == 0);
+
     for (i = 0; i < numBits; i++) {
         Mark(i);
     }
     ASSERT(FindAndSet() == -1);		// bitmap should be full!
+    ASSERT(NumClear() == 0);
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
+    ASSERT(NumClear() == numBits);
 }
@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	look at a word (32 bits) at a time, and the number of clear bits
+//	is kept up to date, rather than counted when it is needed.
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -42,6 +44,15 @@ class Bitmap {
     int FindAndSet();         // Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindAndSetRun(int count);
+    				// Return the # of the first of "count" 
+				// clear bits in a row, and set them.
+				// If there are none, return -1.
+    int FindRun(int count) const;
+    				// Same, but don't set them
+    int NextClear(int which) const;
+    				// Return the # of the first clear bit at
+				// or after "which", or -1
     int NumClear() const;	// Return the number of clear bits
 
     void Print() const;		// Print contents of bitmap
@@ -54,6 +65,14 @@ class Bitmap {
 				//  multiple of the number of bits in
 				//  a word)
     unsigned int *map;		// bit storage
+    int numClear;		// number of clear bits
+    int nextFree;		// every bit before this one is set
+
+    void Recount();		// Recompute numClear and nextFree, after
+    				// changing "map" directly
+    int NextSet(int which) const;
+    				// Return the # of the first set bit at 
+				// or after "which", or numBits
 };
 
 #endif // BITMAP_H
@@ -43,12 +43,51 @@ class Debug {
 extern Debug *debug;
 
 
+//----------------------------------------------------------------------
+// DEBUG_COMPILED
+//      Normally every debugging category can be turned on at run time
+//	with -d, so each DEBUG statement has to ask IsEnabled, even on
+//	the simulator's hottest paths.
+//
+//	If Nachos is instead compiled with -DDEBUG_FLAGS='"..."' (see
+//	the Makefile), only the categories listed in that string can be
+//	enabled, and the tests for all the others are FALSE at compile
+//	time, so their DEBUG statements compile to nothing.
+//	(This needs a C++11 compiler.)
+//----------------------------------------------------------------------
+#ifdef DEBUG_FLAGS
+constexpr bool
+DebugCompiledIn(char flag, const char *flags)
+{
+    return (*flags != '\0') && ((*flags == flag) || (*flags == dbgAll)
+				|| DebugCompiledIn(flag, flags + 1));
+}
+
+template <bool compiledIn> class DebugCompiled {
+  public:
+    static const bool value = compiledIn;
+};
+
+#define DEBUG_COMPILED(flag)                                                 \
+    (DebugCompiled<DebugCompiledIn(flag, DEBUG_FLAGS)>::value)
+#else
+#define DEBUG_COMPILED(flag)	TRUE
+#endif
+
+//----------------------------------------------------------------------
+// DEBUG_ENABLED
+//      Is "flag" enabled?  Use this rather than debug->IsEnabled on 
+//	hot paths, so the test disappears if the category is compiled out.
+//----------------------------------------------------------------------
+#define DEBUG_ENABLED(flag)                                                  \
+    (DEBUG_COMPILED(flag) && debug->IsEnabled(flag))
+
 //----------------------------------------------------------------------
 // DEBUG
 //      If flag is enabled, print a message.
 //----------------------------------------------------------------------
 #define DEBUG(flag,expr)                                                     \
-    if (!debug->IsEnabled(flag)) {} else { 				\
+    if (!DEBUG_ENABLED(flag)) {} else { 				\
         cerr << expr << "\n";   				        \
     }
 
@@ -1,12 +1,14 @@
 // libtest.cc 
 //	Driver code to call self-test routines for standard library
-//	classes -- bitmaps, lists, sorted lists, and hash tables.
+//	classes -- bitmaps, lists, sorted lists, and hash tables -- and
+//	to time the bitmap against a bit-at-a-time version of itself.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
 #include "libtest.h"
 #include "bitmap.h"
 #include "list.h"
@@ -67,6 +69,76 @@ static int listTestVector[] = { 9, 5, 7 };
 static char* hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
      "7", "8", "9", "10", "11", "12", "13", "14" };
 
+//----------------------------------------------------------------------
+// SlowFindAndSet, SlowNumClear
+//	Bitmap::FindAndSet and Bitmap::NumClear as they were first 
+//	written, testing one bit at a time, for comparison.
+//----------------------------------------------------------------------
+
+static int
+SlowFindAndSet(Bitmap *map, int numBits)
+{
+    for (int i = 0; i < numBits; i++) {
+	if (!map->Test(i)) {
+	    map->Mark(i);
+	    return i;
+	}
+    }
+    return -1;
+}
+
+static int
+SlowNumClear(Bitmap *map, int numBits)
+{
+    int count = 0;
+
+    for (int i = 0; i < numBits; i++) {
+	if (!map->Test(i)) {
+	    count++;
+	}
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------
+// BitmapBenchmark
+//	Time filling up a bitmap one bit at a time, checking how many bits
+//	are left before each one, as the file system does when it allocates
+//	sectors; first with Bitmap, then with the bit-at-a-time versions.
+//	Both must give the same answers.
+//----------------------------------------------------------------------
+
+static void
+BitmapBenchmark()
+{
+    const int numBits = 2048;
+    Bitmap *map = new Bitmap(numBits);
+    long long start, wordTime, bitTime;
+    int i;
+
+    start = HostMicroseconds();
+    for (i = 0; i < numBits; i++) {
+	ASSERT(map->NumClear() == numBits - i);
+	ASSERT(map->FindAndSet() == i);
+    }
+    wordTime = HostMicroseconds() - start;
+
+    for (i = 0; i < numBits; i++) {
+	map->Clear(i);
+    }
+
+    start = HostMicroseconds();
+    for (i = 0; i < numBits; i++) {
+	ASSERT(SlowNumClear(map, numBits) == numBits - i);
+	ASSERT(SlowFindAndSet(map, numBits) == i);
+    }
+    bitTime = HostMicroseconds() - start;
+
+    cout << "Bitmap of " << numBits << " bits filled in " << wordTime
+	<< " us (word at a time), " << bitTime << " us (bit at a time)\n";
+    delete map;
+}
+
 //----------------------------------------------------------------------
 // LibSelfTest
 //	Run self tests on bitmaps, lists, sorted lists, and 
@@ -83,6 +155,7 @@ LibSelfTest() {
 
 
     map->SelfTest();
+    BitmapBenchmark();
     list->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector) / sizeof(int));
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector) / sizeof(char*));
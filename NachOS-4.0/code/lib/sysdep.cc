@@ -32,6 +32,7 @@
 #include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <poll.h>
 #include <cerrno>
 
 #ifdef SOLARIS
@@ -50,6 +51,7 @@
 extern "C" {
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #ifndef NO_MPROT 
 #include <sys/mman.h>
@@ -149,6 +151,21 @@ UDelay(unsigned int useconds)
 
 }
 
+//----------------------------------------------------------------------
+// HostMicroseconds
+// 	Return the time of day on the host, in microseconds.  Only the
+//	difference between two calls means anything.
+//----------------------------------------------------------------------
+
+long long
+HostMicroseconds()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -296,6 +313,35 @@ PollFile(int fd)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// WaitForInput
+// 	Block until at least one of several open files or sockets has
+//	characters that can be read (or is at end of file, or in error,
+//	so that reading it will not block either).  Returns immediately
+//	if one already does.
+//
+//	"fds" -- the file descriptors to wait on
+//	"numFds" -- how many there are
+//----------------------------------------------------------------------
+
+void
+WaitForInput(int *fds, int numFds)
+{
+    struct pollfd *pfds = new struct pollfd[numFds];
+    int retVal;
+
+    for (int i = 0; i < numFds; i++) {
+	pfds[i].fd = fds[i];
+	pfds[i].events = POLLIN;
+	pfds[i].revents = 0;
+    }
+    do {
+	retVal = poll(pfds, numFds, -1);	// no timeout
+    } while (retVal < 0 && errno == EINTR);
+    ASSERT(retVal > 0);
+    delete [] pfds;
+}
+
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
@@ -405,6 +451,21 @@ Tell(int fd)
 }
 
 
+//----------------------------------------------------------------------
+// FileIdentity
+// 	Return a number that identifies the file open as "fd", whatever
+//	name it was opened by: its inode number.
+//----------------------------------------------------------------------
+
+int
+FileIdentity(int fd)
+{
+    struct stat buf;
+    int retVal = fstat(fd, &buf);
+    ASSERT(retVal == 0);
+    return (int) (buf.st_ino & 0x7fffffff);
+}
+
 //----------------------------------------------------------------------
 // Close
 // 	Close a file.  Abort on error.
@@ -25,6 +25,9 @@ extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);// rcgood - to avoid spinners.
 
+// Real (host) time in microseconds, for timing parts of Nachos itself
+extern long long HostMicroseconds();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
 
@@ -41,6 +44,10 @@ extern void DeallocBoundedArray(char* p, int size);
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
+// Wait (without using the CPU) until any of several files or sockets
+// has characters to be read.
+extern void WaitForInput(int *fds, int numFds);
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(char* name);
@@ -51,6 +58,7 @@ extern int ReadPartial(int fd, char* buffer, int nBytes);
 extern void WriteFile(int fd, char* buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
+extern int FileIdentity(int fd);
 extern int Close(int fd);
 extern int Unlink(char* name);
 
@@ -37,6 +37,7 @@ ConsoleInput::ConsoleInput(char* readFile, CallBackObj* toCall)
     incoming = EOF;
 
     // start polling for incoming keystrokes
+    kernel->interrupt->WatchInput(readFileNo);
     kernel->interrupt->Schedule(this, ConsoleTime, ConsoleReadInt);
 }
 
@@ -31,6 +31,9 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 			"console read", "network send", 
 			"network recv"};
 
+const int NeverDue = 0x7fffffff;	// nextDue, when nothing is pending
+const int InitialPending = 16;		// initial size of the pending heap
+
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
 // 	Initialize a hardware device interrupt that is to be scheduled 
@@ -52,13 +55,20 @@ PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt,
 //----------------------------------------------------------------------
 // PendingCompare
 //	Compare to interrupts based on which should occur first.
+//	Interrupts due at the same time occur in the order they were
+//	scheduled.
 //----------------------------------------------------------------------
 
 static int
-PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
+PendingCompare (const void *a, const void *b)
 {
+    const PendingInterrupt *x = (const PendingInterrupt *) a;
+    const PendingInterrupt *y = (const PendingInterrupt *) b;
+
     if (x->when < y->when) { return -1; }
     else if (x->when > y->when) { return 1; }
+    else if (x->order < y->order) { return -1; }
+    else if (x->order > y->order) { return 1; }
     else { return 0; }
 }
 
@@ -67,12 +77,23 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 // 	Initialize the simulation of hardware device interrupts.
 //	
 //	Interrupts start disabled, with no interrupts pending, etc.
+//
+//	"blockIdle" -- if TRUE, when there is nothing to run, and
+//		nothing is going to happen until there is input from the
+//		host (keyboard, or network), wait for it in the host OS
+//		instead of simulating one device poll after another
 //----------------------------------------------------------------------
 
-Interrupt::Interrupt()
+Interrupt::Interrupt(bool blockIdle)
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    maxPending = InitialPending;
+    pending = new PendingInterrupt[maxPending];
+    numPending = 0;
+    numScheduled = 0;
+    nextDue = NeverDue;
+    blockWhenIdle = blockIdle;
+    numInputFiles = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -85,10 +106,7 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty()) {
-	delete pending->RemoveFront();
-    }
-    delete pending;
+    delete [] pending;
 }
 
 //----------------------------------------------------------------------
@@ -143,6 +161,10 @@ Interrupt::SetLevel(IntStatus now)
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
+//
+//	A user thread whose program another thread has exited finishes
+//	here, once it is preempted in user mode: it holds no locks, and is
+//	in the middle of nothing.
 //----------------------------------------------------------------------
 void
 Interrupt::OneTick()
@@ -160,7 +182,12 @@ Interrupt::OneTick()
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
-// check any pending interrupts are now ready to fire
+// check any pending interrupts are now ready to fire; most ticks, 
+// none are, and one comparison is enough to tell
+    if (stats->totalTicks < nextDue && !yieldOnReturn 
+		&& !DEBUG_ENABLED(dbgInt)) {
+	return;
+    }
     ChangeLevel(IntOn, IntOff);	// first, turn off interrupts
 				// (interrupt handlers run with
 				// interrupts disabled)
@@ -172,9 +199,37 @@ Interrupt::OneTick()
  	status = SystemMode;		// yield is a kernel routine
 	kernel->currentThread->Yield();
 	status = oldStatus;
+	if (status == UserMode) {	// about to go back to user code:
+	    kernel->machine->RaiseException(NoException, 0);
+	}				// let the kernel have a look first
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::TicksBeforeDue
+// 	Return how many ticks simulated time can advance before the
+//	next pending interrupt is due.  Until then, OneTick would do
+//	nothing but advance the clock, so the simulator is free to run
+//	that many ticks worth of user instructions and charge for them
+//	all at once (see Machine::RunThreaded).
+//
+//	If nothing is pending, nothing can become due; we still return
+//	a bounded number so that the statistics are brought up to date
+//	once in a while.
+//----------------------------------------------------------------------
+
+int
+Interrupt::TicksBeforeDue()
+{
+    int ticks;
+
+    if (nextDue == NeverDue) {
+	return 10000;
+    }
+    ticks = nextDue - kernel->stats->totalTicks - 1;
+    return (ticks > 0) ? ticks : 0;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -209,6 +264,10 @@ Interrupt::Idle()
 {
     DEBUG(dbgInt, "Machine idling; checking for interrupts.");
     status = IdleMode;
+    if (blockWhenIdle && OnlyPollsPending()) {
+	DEBUG(dbgInt, "Machine idling; waiting for host input.");
+	WaitForInput(inputFiles, numInputFiles);
+    }
     if (CheckIfDue(TRUE)) {	// check for any pending interrupts
 	status = SystemMode;
 	return;			// return in case there's now
@@ -226,13 +285,59 @@ Interrupt::Idle()
     Halt();
 }
 
+//----------------------------------------------------------------------
+// Interrupt::WatchInput
+// 	Called by an input device that polls a host file or socket for
+//	data, so that an idle machine can wait for the data to arrive.
+//
+//	"fd" -- the host file descriptor
+//----------------------------------------------------------------------
+
+void
+Interrupt::WatchInput(int fd)
+{
+    ASSERT(numInputFiles < MaxInputFiles);
+    inputFiles[numInputFiles++] = fd;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::OnlyPollsPending
+// 	Return TRUE if, while the machine is idle, every pending interrupt
+//	will do nothing but schedule another one like it, until there is
+//	input from the host: the input devices just poll their files, and
+//	the timer only matters when a thread is running, or sleeping in
+//	Alarm::WaitUntil.  Then there is no point in advancing simulated
+//	time one poll at a time; we may as well wait for the input.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::OnlyPollsPending()
+{
+    if (numInputFiles == 0 || numPending == 0) {
+	return FALSE;
+    }
+    if (kernel->alarm->HasSleepers()) {
+	return FALSE;			// the timer will wake somebody up
+    }
+    for (int i = 0; i < numPending; i++) {
+	if (pending[i].type != TimerInt && pending[i].type != ConsoleReadInt
+		&& pending[i].type != NetworkRecvInt) {
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
+//	The kernel gets to finish what it has in progress (such as 
+//	writes to the disk) first.
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
+    kernel->Shutdown();
     cout << "Machine halting!\n\n";
     kernel->stats->Print();
     delete kernel;	// Never returns.
@@ -243,7 +348,8 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on a heap, kept in an array that is only
+//	reallocated when it fills up.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -257,12 +363,81 @@ void
 Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 {
     int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    PendingInterrupt toOccur(toCall, when, type);
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
-    pending->Insert(toOccur);
+    toOccur.order = numScheduled++;
+    AddPending(&toOccur);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::AddPending
+// 	Insert an interrupt into the heap of pending interrupts: put it
+//	at the end, and move it up past any later interrupts.
+//
+//	"toOccur" -- the interrupt (copied into the heap)
+//----------------------------------------------------------------------
+
+void
+Interrupt::AddPending(PendingInterrupt *toOccur)
+{
+    int i, parent;
+
+    if (numPending == maxPending) {	// out of room; double the heap
+	PendingInterrupt *bigger = new PendingInterrupt[2 * maxPending];
+
+	for (i = 0; i < numPending; i++) {
+	    bigger[i] = pending[i];
+	}
+	delete [] pending;
+	pending = bigger;
+	maxPending *= 2;
+    }
+
+    for (i = numPending++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (PendingCompare(&pending[parent], toOccur) <= 0) {
+	    break;
+	}
+	pending[i] = pending[parent];
+    }
+    pending[i] = *toOccur;
+    nextDue = pending[0].when;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemoveFront
+// 	Take the earliest interrupt off the heap of pending interrupts:
+//	move the last one into its place, and then down past any
+//	earlier interrupts.
+//
+//	"next" -- where to put the earliest interrupt
+//----------------------------------------------------------------------
+
+void
+Interrupt::RemoveFront(PendingInterrupt *next)
+{
+    PendingInterrupt *last;
+    int i, child;
+
+    ASSERT(numPending > 0);
+    *next = pending[0];
+    last = &pending[--numPending];
+    for (i = 0; 2 * i + 1 < numPending; i = child) {
+	child = 2 * i + 1;
+	if (child + 1 < numPending 
+		&& PendingCompare(&pending[child + 1], &pending[child]) < 0) {
+	    child++;			// the earlier of the two children
+	}
+	if (PendingCompare(last, &pending[child]) <= 0) {
+	    break;
+	}
+	pending[i] = pending[child];
+    }
+    pending[i] = *last;
+    nextDue = (numPending > 0) ? pending[0].when : NeverDue;
 }
 
 //----------------------------------------------------------------------
@@ -280,31 +455,30 @@ Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
-    PendingInterrupt *next;
+    PendingInterrupt next;
     Statistics *stats = kernel->stats;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
-    if (debug->IsEnabled(dbgInt)) {
+    if (DEBUG_ENABLED(dbgInt)) {
 	DumpState();
     }
-    if (pending->IsEmpty()) {   	// no pending interrupts
+    if (numPending == 0) {   	// no pending interrupts
 	return FALSE;	
     }		
-    next = pending->Front();
-    if (next->when > stats->totalTicks) {
+    if (nextDue > stats->totalTicks) {
         if (!advanceClock) {		// not time yet
             return FALSE;
         }
         else {      		// advance the clock to next interrupt
-	    stats->idleTicks += (next->when - stats->totalTicks);
-	    stats->totalTicks = next->when;
+	    stats->idleTicks += (nextDue - stats->totalTicks);
+	    stats->totalTicks = nextDue;
 	    // UDelay(1000L); // rcgood - to stop nachos from spinning.
 	}
     }
 
     DEBUG(dbgInt, "Invoking interrupt handler for the ");
-    DEBUG(dbgInt, intTypeNames[next->type] << " at time " << next->when);
+    DEBUG(dbgInt, intTypeNames[pending[0].type] << " at time " << nextDue);
 
     if (kernel->machine != NULL) {
     	kernel->machine->DelayedLoad(0, 0);
@@ -312,11 +486,9 @@ Interrupt::CheckIfDue(bool advanceClock)
 
     inHandler = TRUE;
     do {
-        next = pending->RemoveFront();    // pull interrupt off list
-        next->callOnInterrupt->CallBack();// call the interrupt handler
-	delete next;
-    } while (!pending->IsEmpty() 
-    		&& (pending->Front()->when <= stats->totalTicks));
+        RemoveFront(&next);		// pull interrupt off the heap
+        next.callOnInterrupt->CallBack();// call the interrupt handler
+    } while (nextDue <= stats->totalTicks);
     inHandler = FALSE;
     return TRUE;
 }
@@ -346,6 +518,16 @@ Interrupt::DumpState()
     cout << "Time: " << kernel->stats->totalTicks;
     cout << ", interrupts " << intLevelNames[level] << "\n";
     cout << "Pending interrupts:\n";
-    pending->Apply(PrintPending);
+
+    // the heap is only partly sorted; sort a copy to print it in order
+    PendingInterrupt *sorted = new PendingInterrupt[numPending + 1];
+    for (int i = 0; i < numPending; i++) {
+	sorted[i] = pending[i];
+    }
+    qsort(sorted, numPending, sizeof(PendingInterrupt), PendingCompare);
+    for (int i = 0; i < numPending; i++) {
+	PrintPending(&sorted[i]);
+    }
+    delete [] sorted;
     cout << "\nEnd of pending interrupts\n";
 }
@@ -34,7 +34,6 @@
 #define INTERRUPT_H
 
 #include "copyright.h"
-#include "list.h"
 #include "callback.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
@@ -57,6 +56,7 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
+    PendingInterrupt() {}	// for arrays of them
     PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
@@ -66,6 +66,8 @@ class PendingInterrupt {
     
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int order;		// interrupts due at the same time fire
+    				// in the order they were scheduled
 };
 
 // The following class defines the data structures for the simulation
@@ -73,9 +75,14 @@ class PendingInterrupt {
 // or disabled, and any hardware interrupts that are scheduled to occur
 // in the future.
 
+const int MaxInputFiles = 4;		// host files that devices poll
+
 class Interrupt {
   public:
-    Interrupt();		// initialize the interrupt simulation
+    Interrupt(bool blockIdle);
+    				// initialize the interrupt simulation;
+				// if blockIdle, wait for host input
+				// instead of spinning when idle
     ~Interrupt();		// de-allocate data structures
     
     IntStatus SetLevel(IntStatus level);
@@ -116,24 +123,49 @@ class Interrupt {
     
     void OneTick();       	// Advance simulated time
 
+    int TicksBeforeDue();	// How far simulated time can advance
+				// without any interrupt becoming due
+
+    void WatchInput(int fd);	// An input device polls this host file
+    				// (or socket) for data
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
-    				// the list of interrupts scheduled
-				// to occur in the future
+    PendingInterrupt *pending;	// the interrupts scheduled to occur in
+    				// the future, as a binary heap: the 
+				// earliest is pending[0]
+    int numPending;		// how many are in the heap
+    int maxPending;		// the size of the array; doubled when
+    				// it fills up
+    unsigned int numScheduled;	// interrupts scheduled so far, to order
+    				// the ones due at the same time
+    int nextDue;		// when pending[0] is due, or NeverDue;
+    				// OneTick looks no further unless it is
+				// time
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
 
+    bool blockWhenIdle;		// wait for host input when idle?
+    int inputFiles[MaxInputFiles];	// host files the devices poll
+    int numInputFiles;
+
     // these functions are internal to the interrupt simulation code
 
     bool CheckIfDue(bool advanceClock); 
     				// Check if any interrupts are supposed
 				// to occur now, and if so, do them
+    bool OnlyPollsPending();	// Would every pending interrupt do 
+    				// nothing, unless host input arrives?
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 			IntStatus now); // simulated time
+
+    void AddPending(PendingInterrupt *toOccur);
+    void RemoveFront(PendingInterrupt *next);
+    				// Insert into (or take the earliest
+				// from) the heap, updating nextDue
 };
 
 #endif // INTERRRUPT_H
@@ -50,9 +50,10 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"engine" -- which of the simulator's execution loops Run uses
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, ExecEngine engine)
 {
     int i;
 
@@ -61,6 +62,10 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
+    decodeCache = new Instruction[MemorySize / 4];
+    pageDecoded = new bool[NumPhysPages];
+    FlushDecodeCache();
+    FlushTranslations();
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
     for (i = 0; i < TLBSize; i++)
@@ -72,6 +77,8 @@ Machine::Machine(bool debug)
 #endif
 
     singleStep = debug;
+    this->engine = engine;
+    batchedTicks = 0;
     CheckEndian();
 }
 
@@ -83,6 +90,8 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] decodeCache;
+    delete [] pageDecoded;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -100,13 +109,18 @@ Machine::~Machine()
 void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
+    MachineStatus oldStatus = kernel->interrupt->getStatus();
+
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
     
+    ChargeBatchedTicks();		// the kernel must see the right time
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
-    kernel->interrupt->setStatus(UserMode);
+    kernel->interrupt->setStatus(oldStatus);	// a page fault taken while
+    					// copying system call arguments
+					// returns to the system call
 }
 
 //----------------------------------------------------------------------
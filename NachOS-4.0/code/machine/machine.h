@@ -39,6 +39,8 @@ const int NumPhysPages = 128;
 
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;			// if there is a TLB, make it small
+const int TransCacheSize = 64;		// entries in the simulator's cache
+					// of recent translations
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -88,12 +90,44 @@ enum ExceptionType { NoException,           // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    char opCode;     // Type of instruction.  This is NOT the same as the
+    		     // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd; // Three registers from instruction.
+    int extra;       // Immediate or target or shamt field or offset.
+                     // Immediates are sign-extended.
+};
+
+// The ways the simulator can execute user instructions.  They differ 
+// only in how fast they run on the host, never in what the user 
+// program sees.
+
+enum ExecEngine { SwitchEngine,		// decode cache + switch statement,
+					// one instruction per call
+		  ThreadedEngine,	// jump directly from instruction to
+					// instruction (see RunThreaded)
+		  BlockEngine		// threaded, and only check for 
+		  			// interrupts when one can be due
+};
+
 class Interrupt;
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, ExecEngine engine = SwitchEngine);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -143,15 +177,51 @@ class Machine {
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+
+    bool CopyIn(int virtAddr, char *buffer, int size);
+    bool CopyOut(int virtAddr, char *buffer, int size);
+    				// Copy "size" bytes between virtual memory 
+				// and a kernel buffer, a page at a time.
+				// Return FALSE if a translation failed.
+    int CopyInString(int virtAddr, char *buffer, int maxLength);
+    				// Copy in a null-terminated string of at
+				// most maxLength chars; return its length,
+				// or -1 if a translation failed
+
+    void InvalidateDecodeCache(int physPage);
+    				// Forget the predecoded instructions for
+				// a physical page.  Must be called by
+				// kernel code that changes mainMemory
+				// directly (e.g., when loading a program)
+    void FlushDecodeCache();	// Forget all predecoded instructions
+
+    void InvalidateTranslation(int vpn);
+    				// Forget any cached translation of a 
+				// virtual page.  Must be called whenever
+				// the kernel changes (or clears the use
+				// or dirty bits of) a page table or TLB
+				// entry that may be in use
+    void FlushTranslations();	// Forget all cached translations; called
+				// when switching page tables
   private:
 
 // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
-    
+    void OneInstruction(); 	// Run one instruction of a user program.
+    void RunThreaded();		// Run a user program with the threaded
+				// or block engine; never returns
+    void ChargeBatchedTicks();	// Add the time for instructions run
+				// by the block engine to the statistics
+
+    Instruction *FetchInstruction(int virtAddr);
+    				// Return the decoded instruction at 
+				// virtAddr, decoding its page if needed.
+				// Return NULL on an exception.
+    void DecodePage(int physPage);
+    				// Decode every word of a physical page
+				// into the decode cache
 
 
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
@@ -160,6 +230,10 @@ class Machine {
 				// the translation entry appropriately,
     				// and return an exception code if the 
 				// translation couldn't be completed.
+    ExceptionType TranslateFaulting(int virtAddr, int *physAddr, 
+    				bool writing);
+				// Translate one byte for CopyIn/CopyOut,
+				// letting the kernel handle page faults
 
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
@@ -173,6 +247,22 @@ class Machine {
 
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
+    Instruction *decodeCache;	// one decoded instruction per word of 
+				// physical memory, so that hot loops 
+				// don't re-decode the same code
+    bool *pageDecoded;		// is the decode cache valid for this
+				// physical page?  Cleared on any write
+				// to the page
+
+    ExecEngine engine;		// how Run executes instructions
+    int batchedTicks;		// user time used by the block engine, 
+				// not yet added to the statistics
+
+    TransCacheEntry transCache[TransCacheSize];
+    				// recently used translations, so that
+				// Translate can skip the full page table
+				// or TLB lookup
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
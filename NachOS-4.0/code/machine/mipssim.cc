@@ -24,31 +24,14 @@
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    char opCode;     // Type of instruction.  This is NOT the same as the
-    		     // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd; // Three registers from instruction.
-    int extra;       // Immediate or target or shamt field or offset.
-                     // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
 //	Called by the kernel when the program starts up; never returns.
 //
+//	Instructions are executed by OneInstruction, or by RunThreaded 
+//	if the kernel asked for the threaded or block engine.
+//
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
 //----------------------------------------------------------------------
@@ -56,15 +39,17 @@ class Instruction {
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
-    if (debug->IsEnabled('m')) {
+    if (DEBUG_ENABLED(dbgMach)) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 	cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
+    if (engine != SwitchEngine && !singleStep && 
+		!DEBUG_ENABLED(dbgMach) && !DEBUG_ENABLED(dbgInt))
+	RunThreaded();		// the debugger and per-instruction 
+				// tracing live in the loop below
     for (;;) {
-        OneInstruction(instr);
+        OneInstruction();
 	kernel->interrupt->OneTick();
 	if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
 	  Debugger();
@@ -72,6 +57,79 @@ Machine::Run()
 }
 
 
+//----------------------------------------------------------------------
+// Machine::DecodePage
+// 	Decode every word of a physical page into the decode cache.
+//	Data words decode to something harmless; they are simply never
+//	executed.
+//
+//	"physPage" -- the physical page to decode
+//----------------------------------------------------------------------
+
+void
+Machine::DecodePage(int physPage)
+{
+    int first = physPage * PageSize / 4;
+    unsigned int *words = (unsigned int *) &mainMemory[physPage * PageSize];
+
+    for (int i = 0; i < PageSize / 4; i++) {
+	decodeCache[first + i].value = WordToHost(words[i]);
+	decodeCache[first + i].Decode();
+    }
+    pageDecoded[physPage] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Translate the program counter and return the decoded instruction
+//	stored there.  The first fetch from a physical page decodes the
+//	whole page; later fetches just index into the decode cache,
+//	until something writes to the page.
+//
+//	Returns NULL (after raising the exception) if the translation
+//	failed.
+//
+//	"virtAddr" -- the virtual address of the instruction
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchInstruction(int virtAddr)
+{
+    int physAddr;
+    ExceptionType exception;
+
+    exception = Translate(virtAddr, &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, virtAddr);
+	return NULL;
+    }
+    if (!pageDecoded[physAddr / PageSize])
+	DecodePage(physAddr / PageSize);
+    return &decodeCache[physAddr / 4];
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodeCache, Machine::FlushDecodeCache
+// 	Throw away predecoded instructions, because the kernel changed
+//	the contents of physical memory without going through WriteMem.
+//
+//	"physPage" -- the physical page whose contents changed
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateDecodeCache(int physPage)
+{
+    ASSERT((physPage >= 0) && (physPage < NumPhysPages));
+    pageDecoded[physPage] = FALSE;
+}
+
+void
+Machine::FlushDecodeCache()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	pageDecoded[i] = FALSE;
+}
+
 //----------------------------------------------------------------------
 // TypeToReg
 // 	Retrieve the register # referred to in an instruction. 
@@ -114,28 +172,29 @@ TypeToReg(RegType reg, Instruction *instr)
 //	store all data back to the machine registers and memory before
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
-//	and the register set.
+//	and the register set.  (The decode cache is the one exception,
+//	but it is keyed by physical page and dropped whenever the page
+//	is written, so it never hides a change made by the kernel.)
 //----------------------------------------------------------------------
 
 void
-Machine::OneInstruction(Instruction *instr)
+Machine::OneInstruction()
 {
 #ifdef SIM_FIX
     int byte;       // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
+    Instruction *instr;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
+    // Fetch instruction (already decoded, if we've run this page before)
+    instr = FetchInstruction(registers[PCReg]);
+    if (instr == NULL)
 	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
 
-    if (debug->IsEnabled('m')) {
+    if (DEBUG_ENABLED(dbgMach)) {
         struct OpString *str = &opStrings[instr->opCode];
 	char buf[80];
 
@@ -151,542 +210,18 @@ Machine::OneInstruction(Instruction *instr)
     int sum, diff, tmp, value;
     unsigned int rs, rt, imm;
 
-    // Execute the instruction (cf. Kane's book)
+    // Execute the instruction (cf. Kane's book, and mipsops.cc)
+#define OP(op)	case op:
+#define DONE	break
+#define TRAP	return
     switch (instr->opCode) {
-	
-      case OP_ADD:
-	sum = registers[instr->rs] + registers[instr->rt];
-	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
-	    RaiseException(OverflowException, 0);
-	    return;
-	}
-	registers[instr->rd] = sum;
-	break;
-	
-      case OP_ADDI:
-	sum = registers[instr->rs] + instr->extra;
-	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
-	    ((instr->extra ^ sum) & SIGN_BIT)) {
-	    RaiseException(OverflowException, 0);
-	    return;
-	}
-	registers[instr->rt] = sum;
-	break;
-	
-      case OP_ADDIU:
-	registers[instr->rt] = registers[instr->rs] + instr->extra;
-	break;
-	
-      case OP_ADDU:
-	registers[instr->rd] = registers[instr->rs] + registers[instr->rt];
-	break;
-	
-      case OP_AND:
-	registers[instr->rd] = registers[instr->rs] & registers[instr->rt];
-	break;
-	
-      case OP_ANDI:
-	registers[instr->rt] = registers[instr->rs] & (instr->extra & 0xffff);
-	break;
-	
-      case OP_BEQ:
-	if (registers[instr->rs] == registers[instr->rt])
-	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
-	
-      case OP_BGEZAL:
-	registers[R31] = registers[NextPCReg] + 4;
-      case OP_BGEZ:
-	if (!(registers[instr->rs] & SIGN_BIT))
-	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
-	
-      case OP_BGTZ:
-	if (registers[instr->rs] > 0)
-	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
-	
-      case OP_BLEZ:
-	if (registers[instr->rs] <= 0)
-	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
-	
-      case OP_BLTZAL:
-	registers[R31] = registers[NextPCReg] + 4;
-      case OP_BLTZ:
-	if (registers[instr->rs] & SIGN_BIT)
-	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
-	
-      case OP_BNE:
-	if (registers[instr->rs] != registers[instr->rt])
-	    pcAfter = registers[NextPCReg] + IndexToAddr(instr->extra);
-	break;
-	
-      case OP_DIV:
-	if (registers[instr->rt] == 0) {
-	    registers[LoReg] = 0;
-	    registers[HiReg] = 0;
-	} else {
-	    registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
-	    registers[HiReg] = registers[instr->rs] % registers[instr->rt];
-	}
-	break;
-	
-      case OP_DIVU:	  
-	  rs = (unsigned int) registers[instr->rs];
-	  rt = (unsigned int) registers[instr->rt];
-	  if (rt == 0) {
-	      registers[LoReg] = 0;
-	      registers[HiReg] = 0;
-	  } else {
-	      tmp = rs / rt;
-	      registers[LoReg] = (int) tmp;
-	      tmp = rs % rt;
-	      registers[HiReg] = (int) tmp;
-	  }
-	  break;
-	
-      case OP_JAL:
-	registers[R31] = registers[NextPCReg] + 4;
-      case OP_J:
-	pcAfter = (pcAfter & 0xf0000000) | IndexToAddr(instr->extra);
-	break;
-	
-      case OP_JALR:
-	registers[instr->rd] = registers[NextPCReg] + 4;
-      case OP_JR:
-	pcAfter = registers[instr->rs];
-	break;
-	
-      case OP_LB:
-      case OP_LBU:
-	tmp = registers[instr->rs] + instr->extra;
-	if (!ReadMem(tmp, 1, &value))
-	    return;
-
-	if ((value & 0x80) && (instr->opCode == OP_LB))
-	    value |= 0xffffff00;
-	else
-	    value &= 0xff;
-	nextLoadReg = instr->rt;
-	nextLoadValue = value;
-	break;
-	
-      case OP_LH:
-      case OP_LHU:	  
-	tmp = registers[instr->rs] + instr->extra;
-	if (tmp & 0x1) {
-	    RaiseException(AddressErrorException, tmp);
-	    return;
-	}
-	if (!ReadMem(tmp, 2, &value))
-	    return;
-
-	if ((value & 0x8000) && (instr->opCode == OP_LH))
-	    value |= 0xffff0000;
-	else
-	    value &= 0xffff;
-	nextLoadReg = instr->rt;
-	nextLoadValue = value;
-	break;
-      	
-      case OP_LUI:
-	DEBUG(dbgMach, "Executing: LUI r" << instr->rt << ", " << instr->extra);
-	registers[instr->rt] = instr->extra << 16;
-	break;
-	
-      case OP_LW:
-	tmp = registers[instr->rs] + instr->extra;
-	if (tmp & 0x3) {
-	    RaiseException(AddressErrorException, tmp);
-	    return;
-	}
-	if (!ReadMem(tmp, 4, &value))
-	    return;
-	nextLoadReg = instr->rt;
-	nextLoadValue = value;
-	break;
-    	
-      case OP_LWL:	  
-	tmp = registers[instr->rs] + instr->extra;
-
-#ifdef SIM_FIX
-	// The only difference between this code and the BIG ENDIAN code
-        // is that the ReadMem call is guaranteed an aligned access as it
-        // should be (Kane's book hides the fact that all memory access
-        // are done using aligned loads - what the instruction asks for
-        // is a arbitrary) This is the whole purpose of LWL and LWR etc.
-        // Then the switch uses  3 - (tmp & 0x3)  instead of (tmp & 0x3)
-
-        byte = tmp & 0x3;
-        // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
-#else
-	// ReadMem assumes all 4 byte requests are aligned on an even 
-	// word boundary.  Also, the little endian/big endian swap code would
-        // fail (I think) if the other cases are ever exercised.
-	ASSERT((tmp & 0x3) == 0);  
-
-	if (!ReadMem(tmp, 4, &value))
-	    return;
-#endif
-
-	if (registers[LoadReg] == instr->rt)
-	    nextLoadValue = registers[LoadValueReg];
-	else
-	    nextLoadValue = registers[instr->rt];
-#ifdef SIM_FIX
-	switch (3 - byte) 
-#else
-	switch (tmp & 0x3)
-#endif
-	  {
-	  case 0:
-	    nextLoadValue = value;
-	    break;
-	  case 1:
-	    nextLoadValue = (nextLoadValue & 0xff) | (value << 8);
-	    break;
-	  case 2:
-	    nextLoadValue = (nextLoadValue & 0xffff) | (value << 16);
-	    break;
-	  case 3:
-	    nextLoadValue = (nextLoadValue & 0xffffff) | (value << 24);
-	    break;
-	}
-	nextLoadReg = instr->rt;
-	break;
-      	
-      case OP_LWR:
-	tmp = registers[instr->rs] + instr->extra;
-
-#ifdef SIM_FIX
-        // The only difference between this code and the BIG ENDIAN code
-        // is that the ReadMem call is guaranteed an aligned access as it
-        // should be (Kane's book hides the fact that all memory access
-        // are done using aligned loads - what the instruction asks 
-        // for is a arbitrary) This is the whole purpose of LWL and LWR etc.
-        // Then the switch uses  3 - (tmp & 0x3)  instead of (tmp & 0x3)
-
-        byte = tmp & 0x3;
-        // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
-#else
-	// ReadMem assumes all 4 byte requests are aligned on an even 
-	// word boundary.  Also, the little endian/big endian swap code would
-        // fail (I think) if the other cases are ever exercised.
-	ASSERT((tmp & 0x3) == 0);  
-
-	if (!ReadMem(tmp, 4, &value))
-	    return;
-#endif
-
-	if (registers[LoadReg] == instr->rt)
-	    nextLoadValue = registers[LoadValueReg];
-	else
-	    nextLoadValue = registers[instr->rt];
-
-#ifdef SIM_FIX
-	switch (3 - byte) 
-#else
-	switch (tmp & 0x3)
-#endif
-	  {
-	  case 0:
-	    nextLoadValue = (nextLoadValue & 0xffffff00) |
-		((value >> 24) & 0xff);
-	    break;
-	  case 1:
-	    nextLoadValue = (nextLoadValue & 0xffff0000) |
-		((value >> 16) & 0xffff);
-	    break;
-	  case 2:
-	    nextLoadValue = (nextLoadValue & 0xff000000)
-		| ((value >> 8) & 0xffffff);
-	    break;
-	  case 3:
-	    nextLoadValue = value;
-	    break;
-	}
-	nextLoadReg = instr->rt;
-	break;
-    	
-      case OP_MFHI:
-	registers[instr->rd] = registers[HiReg];
-	break;
-	
-      case OP_MFLO:
-	registers[instr->rd] = registers[LoReg];
-	break;
-	
-      case OP_MTHI:
-	registers[HiReg] = registers[instr->rs];
-	break;
-	
-      case OP_MTLO:
-	registers[LoReg] = registers[instr->rs];
-	break;
-	
-      case OP_MULT:
-	Mult(registers[instr->rs], registers[instr->rt], TRUE,
-	     &registers[HiReg], &registers[LoReg]);
-	break;
-	
-      case OP_MULTU:
-	Mult(registers[instr->rs], registers[instr->rt], FALSE,
-	     &registers[HiReg], &registers[LoReg]);
-	break;
-	
-      case OP_NOR:
-	registers[instr->rd] = ~(registers[instr->rs] | registers[instr->rt]);
-	break;
-	
-      case OP_OR:
-	registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
-	break;
-	
-      case OP_ORI:
-	registers[instr->rt] = registers[instr->rs] | (instr->extra & 0xffff);
-	break;
-	
-      case OP_SB:
-	if (!WriteMem((unsigned) 
-		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
-	break;
-	
-      case OP_SH:
-	if (!WriteMem((unsigned) 
-		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
-	break;
-	
-      case OP_SLL:
-	registers[instr->rd] = registers[instr->rt] << instr->extra;
-	break;
-	
-      case OP_SLLV:
-	registers[instr->rd] = registers[instr->rt] <<
-	    (registers[instr->rs] & 0x1f);
-	break;
-	
-      case OP_SLT:
-	if (registers[instr->rs] < registers[instr->rt])
-	    registers[instr->rd] = 1;
-	else
-	    registers[instr->rd] = 0;
-	break;
-	
-      case OP_SLTI:
-	if (registers[instr->rs] < instr->extra)
-	    registers[instr->rt] = 1;
-	else
-	    registers[instr->rt] = 0;
-	break;
-	
-      case OP_SLTIU:	  
-	rs = registers[instr->rs];
-	imm = instr->extra;
-	if (rs < imm)
-	    registers[instr->rt] = 1;
-	else
-	    registers[instr->rt] = 0;
-	break;
-      	
-      case OP_SLTU:	  
-	rs = registers[instr->rs];
-	rt = registers[instr->rt];
-	if (rs < rt)
-	    registers[instr->rd] = 1;
-	else
-	    registers[instr->rd] = 0;
-	break;
-      	
-      case OP_SRA:
-	registers[instr->rd] = registers[instr->rt] >> instr->extra;
-	break;
-	
-      case OP_SRAV:
-	registers[instr->rd] = registers[instr->rt] >>
-	    (registers[instr->rs] & 0x1f);
-	break;
-	
-      case OP_SRL:
-	tmp = registers[instr->rt];
-	tmp >>= instr->extra;
-	registers[instr->rd] = tmp;
-	break;
-	
-      case OP_SRLV:
-	tmp = registers[instr->rt];
-	tmp >>= (registers[instr->rs] & 0x1f);
-	registers[instr->rd] = tmp;
-	break;
-	
-      case OP_SUB:	  
-	diff = registers[instr->rs] - registers[instr->rt];
-	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
-	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
-	    RaiseException(OverflowException, 0);
-	    return;
-	}
-	registers[instr->rd] = diff;
-	break;
-      	
-      case OP_SUBU:
-	registers[instr->rd] = registers[instr->rs] - registers[instr->rt];
-	break;
-	
-      case OP_SW:
-	if (!WriteMem((unsigned) 
-		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
-	break;
-	
-      case OP_SWL:	  
-	tmp = registers[instr->rs] + instr->extra;
-
-#ifdef SIM_FIX
-        // The only difference between this code and the BIG ENDIAN code
-        // is that the ReadMem call is guaranteed an aligned access as it
-        // should be (Kane's book hides the fact that all memory access
-        // are done using aligned loads - what the instruction asks for
-        // is a arbitrary) This is the whole purpose of LWL and LWR etc.
-
-        byte = tmp & 0x3;
-        // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
-
-        // DEBUG('P', "Value 0x%X\n",value);
-#else
-
-	// The little endian/big endian swap code would
-        // fail (I think) if the other cases are ever exercised.
-	ASSERT((tmp & 0x3) == 0);  
-
-	if (!ReadMem((tmp & ~0x3), 4, &value))
-	    return;
-#endif
-
-#ifdef SIM_FIX
-	switch( 3 - byte )
-#else
-	  switch (tmp & 0x3) 
-#endif // SIM_FIX
-	    {
-	  case 0:
-	    value = registers[instr->rt];
-	    break;
-	  case 1:
-	    value = (value & 0xff000000) | ((registers[instr->rt] >> 8) &
-					    0xffffff);
-	    break;
-	  case 2:
-	    value = (value & 0xffff0000) | ((registers[instr->rt] >> 16) &
-					    0xffff);
-	    break;
-	  case 3:
-	    value = (value & 0xffffff00) | ((registers[instr->rt] >> 24) &
-					    0xff);
-	    break;
-	}
-#ifndef SIM_FIX
-        if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
-#else
-        // DEBUG('P', "Value 0x%X\n",value);
-
-        if (!WriteMem((tmp - byte), 4, value))
-            return;
-#endif // SIM_FIX
-	break;
-    	
-      case OP_SWR:	  
-	tmp = registers[instr->rs] + instr->extra;
-
-#ifndef SIM_FIX
-        // The little endian/big endian swap code would
-        // fail (I think) if the other cases are ever exercised.
-        ASSERT((tmp & 0x3) == 0);  
-
-        if (!ReadMem((tmp & ~0x3), 4, &value))
-            return;
-#else
-        // The only difference between this code and the BIG ENDIAN code
-        // is that the ReadMem call is guaranteed an aligned access as 
-        // it should be (Kane's book hides the fact that all memory 
-        // access are done using aligned loads - what the instruction 
-        // asks for is a arbitrary) This is the whole purpose of LWL 
-        // and LWR etc.
-
-        byte = tmp & 0x3;
-        // DEBUG('P', "Addr 0x%X\n",tmp-byte);
-
-        if (!ReadMem(tmp-byte, 4, &value))
-            return;
-        // DEBUG('P', "Value 0x%X\n",value);
-#endif // SIM_FIX
-
-#ifndef SIM_FIX
-        switch (tmp & 0x3) 
-#else
-	  switch( 3 - byte ) 
-#endif // SIM_FIX
-	    {
-	    case 0:
-	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
-	    break;
-	  case 1:
-	    value = (value & 0xffff) | (registers[instr->rt] << 16);
-	    break;
-	  case 2:
-	    value = (value & 0xff) | (registers[instr->rt] << 8);
-	    break;
-	  case 3:
-	    value = registers[instr->rt];
-	    break;
-	}
-
-#ifndef SIM_FIX
-        if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
-#else
-        // DEBUG('P', "Value 0x%X\n",value);
-
-        if (!WriteMem((tmp - byte), 4, value))
-            return;
-#endif // SIM_FIX
-
-
-	break;
-    	
-      case OP_SYSCALL:
-	RaiseException(SyscallException, 0);
-	return; 
-	
-      case OP_XOR:
-	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
-	break;
-	
-      case OP_XORI:
-	registers[instr->rt] = registers[instr->rs] ^ (instr->extra & 0xffff);
-	break;
-	
-      case OP_RES:
-      case OP_UNIMP:
-	RaiseException(IllegalInstrException, 0);
-	return;
-	
+#include "mipsops.cc"
       default:
 	ASSERT(FALSE);
     }
+#undef OP
+#undef DONE
+#undef TRAP
     
     // Now we have successfully executed the instruction.
     
@@ -700,6 +235,171 @@ Machine::OneInstruction(Instruction *instr)
     registers[NextPCReg] = pcAfter;
 }
 
+//----------------------------------------------------------------------
+// Machine::RunThreaded
+// 	Execute user instructions using "threaded code": rather than
+//	returning to a loop that switches on each opcode, the end of 
+//	every instruction fetches the next decoded instruction and jumps
+//	directly to the code for its opcode, through a table of label
+//	addresses (a gcc extension).  Each instruction then gets its own
+//	indirect jump, which the host's branch predictor handles much 
+//	better than the single jump of a switch statement.
+//
+//	The instructions themselves come from mipsops.cc, exactly as in
+//	OneInstruction, and we still call OneTick after every 
+//	instruction, so the simulated machine (including delayed loads,
+//	branch delay slots, exceptions and interrupt timing) behaves 
+//	identically.  Like Run, never returns, and is re-entrant.
+//
+//	With the block engine, we go further: as long as no interrupt can
+//	be due, OneTick would only advance the clock, so we run 
+//	instructions back to back (across branches, making one long
+//	superblock) and charge UserTick for each of them in one go, 
+//	either when the next interrupt is about to become due or when an 
+//	instruction traps to the kernel.  The instruction during which an
+//	interrupt becomes due still goes through OneTick, so interrupts 
+//	and context switches happen at exactly the same simulated time.
+//----------------------------------------------------------------------
+
+void
+Machine::RunThreaded()
+{
+    static void *dispatch[MaxOpcode + 1];
+    static bool dispatchReady = FALSE;
+
+#ifdef SIM_FIX
+    int byte;       // described in Kane for LWL,LWR,...
+#endif
+    Instruction *instr;
+    int nextLoadReg, nextLoadValue, pcAfter;
+    int sum, diff, tmp, value;
+    unsigned int rs, rt, imm;
+    int quiet;			// # of instructions we can still run 
+				// without calling OneTick
+
+    if (!dispatchReady) {
+	for (int i = 0; i <= MaxOpcode; i++)
+	    dispatch[i] = &&L_BAD;
+	dispatch[OP_ADD] = &&L_OP_ADD;
+	dispatch[OP_ADDI] = &&L_OP_ADDI;
+	dispatch[OP_ADDIU] = &&L_OP_ADDIU;
+	dispatch[OP_ADDU] = &&L_OP_ADDU;
+	dispatch[OP_AND] = &&L_OP_AND;
+	dispatch[OP_ANDI] = &&L_OP_ANDI;
+	dispatch[OP_BEQ] = &&L_OP_BEQ;
+	dispatch[OP_BGEZAL] = &&L_OP_BGEZAL;
+	dispatch[OP_BGEZ] = &&L_OP_BGEZ;
+	dispatch[OP_BGTZ] = &&L_OP_BGTZ;
+	dispatch[OP_BLEZ] = &&L_OP_BLEZ;
+	dispatch[OP_BLTZAL] = &&L_OP_BLTZAL;
+	dispatch[OP_BLTZ] = &&L_OP_BLTZ;
+	dispatch[OP_BNE] = &&L_OP_BNE;
+	dispatch[OP_DIV] = &&L_OP_DIV;
+	dispatch[OP_DIVU] = &&L_OP_DIVU;
+	dispatch[OP_JAL] = &&L_OP_JAL;
+	dispatch[OP_J] = &&L_OP_J;
+	dispatch[OP_JALR] = &&L_OP_JALR;
+	dispatch[OP_JR] = &&L_OP_JR;
+	dispatch[OP_LB] = &&L_OP_LB;
+	dispatch[OP_LBU] = &&L_OP_LBU;
+	dispatch[OP_LH] = &&L_OP_LH;
+	dispatch[OP_LHU] = &&L_OP_LHU;
+	dispatch[OP_LUI] = &&L_OP_LUI;
+	dispatch[OP_LW] = &&L_OP_LW;
+	dispatch[OP_LWL] = &&L_OP_LWL;
+	dispatch[OP_LWR] = &&L_OP_LWR;
+	dispatch[OP_MFHI] = &&L_OP_MFHI;
+	dispatch[OP_MFLO] = &&L_OP_MFLO;
+	dispatch[OP_MTHI] = &&L_OP_MTHI;
+	dispatch[OP_MTLO] = &&L_OP_MTLO;
+	dispatch[OP_MULT] = &&L_OP_MULT;
+	dispatch[OP_MULTU] = &&L_OP_MULTU;
+	dispatch[OP_NOR] = &&L_OP_NOR;
+	dispatch[OP_OR] = &&L_OP_OR;
+	dispatch[OP_ORI] = &&L_OP_ORI;
+	dispatch[OP_SB] = &&L_OP_SB;
+	dispatch[OP_SH] = &&L_OP_SH;
+	dispatch[OP_SLL] = &&L_OP_SLL;
+	dispatch[OP_SLLV] = &&L_OP_SLLV;
+	dispatch[OP_SLT] = &&L_OP_SLT;
+	dispatch[OP_SLTI] = &&L_OP_SLTI;
+	dispatch[OP_SLTIU] = &&L_OP_SLTIU;
+	dispatch[OP_SLTU] = &&L_OP_SLTU;
+	dispatch[OP_SRA] = &&L_OP_SRA;
+	dispatch[OP_SRAV] = &&L_OP_SRAV;
+	dispatch[OP_SRL] = &&L_OP_SRL;
+	dispatch[OP_SRLV] = &&L_OP_SRLV;
+	dispatch[OP_SUB] = &&L_OP_SUB;
+	dispatch[OP_SUBU] = &&L_OP_SUBU;
+	dispatch[OP_SW] = &&L_OP_SW;
+	dispatch[OP_SWL] = &&L_OP_SWL;
+	dispatch[OP_SWR] = &&L_OP_SWR;
+	dispatch[OP_SYSCALL] = &&L_OP_SYSCALL;
+	dispatch[OP_XOR] = &&L_OP_XOR;
+	dispatch[OP_XORI] = &&L_OP_XORI;
+	dispatch[OP_RES] = &&L_OP_RES;
+	dispatch[OP_UNIMP] = &&L_OP_UNIMP;
+	dispatchReady = TRUE;
+    }
+
+  refill:
+    if (engine == BlockEngine)
+	quiet = kernel->interrupt->TicksBeforeDue() / UserTick;
+    else
+	quiet = 0;
+  fetch:
+    instr = FetchInstruction(registers[PCReg]);
+    if (instr == NULL)
+	goto tick;			// exception occurred
+    nextLoadReg = 0;
+    nextLoadValue = 0;
+    pcAfter = registers[NextPCReg] + 4;
+    goto *dispatch[(int) instr->opCode];
+
+#define OP(op)	L_##op:
+#define DONE	goto retire
+#define TRAP	goto tick
+#include "mipsops.cc"
+#undef OP
+#undef DONE
+#undef TRAP
+
+  L_BAD:
+    ASSERT(FALSE);
+
+  retire:
+    DelayedLoad(nextLoadReg, nextLoadValue);
+    registers[PrevPCReg] = registers[PCReg];
+    registers[PCReg] = registers[NextPCReg];
+    registers[NextPCReg] = pcAfter;
+    if (quiet > 0) {		// nothing can happen yet; keep going
+	quiet--;
+	batchedTicks += UserTick;
+	goto fetch;
+    }
+  tick:
+    ChargeBatchedTicks();
+    kernel->interrupt->OneTick();
+    goto refill;
+}
+
+//----------------------------------------------------------------------
+// Machine::ChargeBatchedTicks
+// 	Add the user time for the instructions that the block engine has
+//	run since it last called OneTick to the statistics.  Must be done
+//	before anything in the kernel can look at the clock.
+//----------------------------------------------------------------------
+
+void
+Machine::ChargeBatchedTicks()
+{
+    if (batchedTicks > 0) {
+	kernel->stats->totalTicks += batchedTicks;
+	kernel->stats->userTicks += batchedTicks;
+	batchedTicks = 0;
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::DelayedLoad
 // 	Simulate effects of a delayed load.
@@ -32,6 +32,7 @@ NetworkInput::NetworkInput(CallBackObj *toCall)
 						 // in the current directory.
 
     // start polling for incoming packets
+    kernel->interrupt->WatchInput(sock);
     kernel->interrupt->Schedule(this, NetworkTime, NetworkRecvInt);
 }
 
@@ -30,6 +30,10 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numCacheHits;		// number of sectors found in the sector cache
+    int numCacheMisses;		// number of sectors that were not there
+    int numLogCommits;		// number of journal transactions committed
+    int numLogSectors;		// number of sectors written to the log
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
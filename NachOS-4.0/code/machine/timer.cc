@@ -33,16 +33,35 @@
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
 //      "toCall" is the interrupt handler to call when the timer expires.
+//	"ticks" -- the (average) time between interrupts
 //----------------------------------------------------------------------
 
-Timer::Timer(bool doRandom, CallBackObj *toCall)
+Timer::Timer(bool doRandom, CallBackObj *toCall, int ticks)
 {
     randomize = doRandom;
     callPeriodically = toCall;
+    period = ticks;
     disable = FALSE;
+    pending = FALSE;
     SetInterrupt();
 }
 
+//----------------------------------------------------------------------
+// Timer::Enable
+//      Turn the timer back on, after Disable.  If the interrupt that was
+//	on its way when it was disabled has not come yet, it will do; 
+//	otherwise, schedule a new one.
+//----------------------------------------------------------------------
+
+void
+Timer::Enable()
+{
+    disable = FALSE;
+    if (!pending) {
+	SetInterrupt();
+    }
+}
+
 //----------------------------------------------------------------------
 // Timer::CallBack
 //      Routine called when interrupt is generated by the hardware 
@@ -55,6 +74,7 @@ Timer::CallBack()
     // invoke the Nachos interrupt handler for this device
     callPeriodically->CallBack();
     
+    pending = FALSE;
     SetInterrupt();	// do last, to let software interrupt handler
     			// decide if it wants to disable future interrupts
 }
@@ -70,12 +90,13 @@ void
 Timer::SetInterrupt() 
 {
     if (!disable) {
-       int delay = TimerTicks;
+       int delay = period;
     
        if (randomize) {
-	     delay = 1 + (RandomNumber() % (TimerTicks * 2));
+	     delay = 1 + (RandomNumber() % (period * 2));
         }
        // schedule the next timer device interrupt
        kernel->interrupt->Schedule(this, delay, TimerInt);
+       pending = TRUE;
     }
 }
@@ -11,6 +11,10 @@
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	Like many real timers, the period can be programmed (Nachos sets
+//	it to the scheduler's time slice), and the timer can be turned
+//	off when nobody needs it, and back on later.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
@@ -23,24 +27,30 @@
 #include "copyright.h"
 #include "utility.h"
 #include "callback.h"
+#include "stats.h"
 
 // The following class defines a hardware timer. 
 class Timer : public CallBackObj {
   public:
-    Timer(bool doRandom, CallBackObj *toCall);
+    Timer(bool doRandom, CallBackObj *toCall, int ticks = TimerTicks);
 				// Initialize the timer, and callback to "toCall"
-				// every time slice.
+				// every "ticks" time units.
     virtual ~Timer() {}
     
     void Disable() { disable = TRUE; }
     				// Turn timer device off, so it doesn't
 				// generate any more interrupts.
+    void Enable();		// Turn it back on; the next interrupt is
+    				// a full period away, unless one is 
+				// already on its way.
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
-    CallBackObj *callPeriodically; // call this every TimerTicks time units 
+    CallBackObj *callPeriodically; // call this every "period" time units 
+    int period;			// time between interrupts
     bool disable;		// turn off the timer device after next
     				// interrupt.
+    bool pending;		// is an interrupt on its way?
     
     void CallBack();		// called internally when the hardware
 				// timer generates an interrupt
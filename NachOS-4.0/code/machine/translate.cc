@@ -145,6 +145,7 @@ Machine::WriteMem(int addr, int size, int value)
 	RaiseException(exception, addr);
 	return FALSE;
     }
+    pageDecoded[physicalAddress / PageSize] = FALSE;	// may be code
     switch (size) {
       case 1:
 	mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -166,6 +167,171 @@ Machine::WriteMem(int addr, int size, int value)
     return TRUE;
 }
 
+// How many times CopyIn and friends let the kernel handle a fault on
+// the same page before giving up.  A write to a page of the program 
+// that was never touched takes two: one to bring it in, shared and 
+// read-only, and one to copy it.  The page may also be evicted again
+// while the kernel waits for the disk.
+const int MaxFaultRetries = 4;
+
+//----------------------------------------------------------------------
+// Machine::TranslateFaulting
+//      Translate a virtual address for the kernel, one byte at a time,
+//	as CopyIn and CopyOut do.  A page fault, or a write to a shared
+//	page, is passed to the kernel, and the translation is retried,
+//	until it works or the kernel has had MaxFaultRetries tries.
+//
+//   	Returns the exception, if the kernel could not resolve it (it has
+//	been raised already, just like in ReadMem).
+//
+//	"virtAddr" -- the virtual address to translate
+//	"physAddr" -- where to store the physical address
+//	"writing" -- TRUE if the kernel is going to write there
+//----------------------------------------------------------------------
+
+ExceptionType
+Machine::TranslateFaulting(int virtAddr, int *physAddr, bool writing)
+{
+    ExceptionType exception;
+    int tries = 0;
+
+    exception = Translate(virtAddr, physAddr, 1, writing);
+    while ((exception == PageFaultException 
+		|| exception == ReadOnlyException) && tries < MaxFaultRetries) {
+	RaiseException(exception, virtAddr);	// have the kernel bring the
+	tries++;				// page in (or copy it), and
+	exception = Translate(virtAddr, physAddr, 1, writing);	// retry
+    }
+    if (exception != NoException) {
+	RaiseException(exception, virtAddr);
+    }
+    return exception;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyIn
+//      Copy "size" bytes of virtual memory at "virtAddr" into the 
+//	kernel buffer "buffer".  We translate once per page, and copy
+//	everything on that page at once, rather than going through 
+//	ReadMem a byte at a time.
+//
+//	Page faults are passed to the kernel (see TranslateFaulting).
+//
+//   	Returns FALSE (after raising the exception, just like ReadMem) if
+//	the kernel could not bring some page in; part of the data may have
+//	been copied by then.
+//
+//	"virtAddr" -- the virtual address to copy from
+//	"buffer" -- the kernel buffer to copy into
+//	"size" -- the number of bytes to copy
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyIn(int virtAddr, char *buffer, int size)
+{
+    ExceptionType exception;
+    int physicalAddress, chunk;
+
+    DEBUG(dbgAddr, "Copying in " << size << " bytes from VA " << virtAddr);
+
+    while (size > 0) {
+	exception = TranslateFaulting(virtAddr, &physicalAddress, FALSE);
+	if (exception != NoException) {
+	    return FALSE;
+	}
+	chunk = min(size, PageSize - (int) ((unsigned) virtAddr % PageSize));
+	memcpy(buffer, &mainMemory[physicalAddress], chunk);
+	virtAddr += chunk;
+	buffer += chunk;
+	size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyOut
+//      Copy "size" bytes from the kernel buffer "buffer" into virtual 
+//	memory at "virtAddr", a page at a time.
+//
+//	Page faults, and writes to shared pages, are passed to the kernel
+//	(see TranslateFaulting).
+//
+//   	Returns FALSE (after raising the exception, just like WriteMem) 
+//	if the kernel could not make some page writable.
+//
+//	"virtAddr" -- the virtual address to copy to
+//	"buffer" -- the kernel buffer to copy from
+//	"size" -- the number of bytes to copy
+//----------------------------------------------------------------------
+
+bool
+Machine::CopyOut(int virtAddr, char *buffer, int size)
+{
+    ExceptionType exception;
+    int physicalAddress, chunk;
+
+    DEBUG(dbgAddr, "Copying out " << size << " bytes to VA " << virtAddr);
+
+    while (size > 0) {
+	exception = TranslateFaulting(virtAddr, &physicalAddress, TRUE);
+	if (exception != NoException) {
+	    return FALSE;
+	}
+	chunk = min(size, PageSize - (int) ((unsigned) virtAddr % PageSize));
+	memcpy(&mainMemory[physicalAddress], buffer, chunk);
+	pageDecoded[physicalAddress / PageSize] = FALSE;	// may be code
+	virtAddr += chunk;
+	buffer += chunk;
+	size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CopyInString
+//      Copy a null-terminated string from virtual memory at "virtAddr"
+//	into the kernel buffer "buffer", a page at a time, stopping after
+//	at most "maxLength" characters.  The result in "buffer" is always
+//	null-terminated, so it must have room for maxLength + 1 bytes.
+//
+//   	Returns the length of the string copied (maxLength, if the string
+//	was too long), or -1 if the translation of some page failed (after
+//	raising the exception).
+//
+//	"virtAddr" -- the virtual address of the string
+//	"buffer" -- the kernel buffer to copy into
+//	"maxLength" -- the most characters to copy, not counting the null
+//----------------------------------------------------------------------
+
+int
+Machine::CopyInString(int virtAddr, char *buffer, int maxLength)
+{
+    ExceptionType exception;
+    int physicalAddress, chunk, length = 0;
+    char *end;
+
+    DEBUG(dbgAddr, "Copying in a string from VA " << virtAddr);
+
+    while (length < maxLength) {
+	exception = TranslateFaulting(virtAddr, &physicalAddress, FALSE);
+	if (exception != NoException) {
+	    return -1;
+	}
+	chunk = min(maxLength - length, 
+			PageSize - (int) ((unsigned) virtAddr % PageSize));
+	end = (char *) memchr(&mainMemory[physicalAddress], '\0', chunk);
+	if (end != NULL)			// found the end of the string
+	    chunk = end - &mainMemory[physicalAddress];
+	memcpy(buffer + length, &mainMemory[physicalAddress], chunk);
+	length += chunk;
+	if (end != NULL)
+	    break;
+	virtAddr += chunk;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -175,6 +341,14 @@ Machine::WriteMem(int addr, int size, int value)
 //	address in "physAddr".  If there was an error, returns the type
 //	of the exception.
 //
+//	Successful translations are remembered in a small direct-mapped
+//	cache, keyed by the virtual page and whether we were writing.
+//	A hit means that the entry has already been checked and its 
+//	use bit (and, for a write, dirty bit) is already set, so only 
+//	the alignment check is left to do.  The kernel must tell us 
+//	(InvalidateTranslation, FlushTranslations) when it changes a 
+//	translation or clears its use/dirty bits.
+//
 //	"virtAddr" -- the virtual address to translate
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
@@ -188,6 +362,17 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
+    TransCacheEntry *cached;
+    int key;
+
+// fast path: a page we have translated the same way before
+    vpn = (unsigned) virtAddr / PageSize;
+    key = (vpn << 1) | (writing ? 1 : 0);
+    cached = &transCache[key % TransCacheSize];
+    if (cached->key == key && !(virtAddr & (size - 1))) {
+	*physAddr = cached->frameAddr + (unsigned) virtAddr % PageSize;
+	return NoException;
+    }
 
     DEBUG(dbgAddr, "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
 
@@ -201,9 +386,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     ASSERT(tlb == NULL || pageTable == NULL);	
     ASSERT(tlb != NULL || pageTable != NULL);	
 
-// calculate the virtual page number, and offset within the page,
-// from the virtual address
-    vpn = (unsigned) virtAddr / PageSize;
+// calculate the offset within the page (we already have the
+// virtual page number) from the virtual address
     offset = (unsigned) virtAddr % PageSize;
     
     if (tlb == NULL) {		// => page table => vpn is index into table
@@ -247,5 +431,42 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG(dbgAddr, "phys addr = " << *physAddr);
+    if (!DEBUG_ENABLED(dbgAddr)) {	// keep the trace complete
+	cached->key = key;
+	cached->frameAddr = pageFrame * PageSize;
+    }
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::InvalidateTranslation
+// 	Drop the cached translations (for reading and for writing) of 
+//	one virtual page, because the kernel changed its page table or
+//	TLB entry.
+//
+//	"vpn" -- the virtual page number
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateTranslation(int vpn)
+{
+    int key = vpn << 1;
+
+    if (transCache[key % TransCacheSize].key == key)
+	transCache[key % TransCacheSize].key = -1;
+    if (transCache[(key + 1) % TransCacheSize].key == key + 1)
+	transCache[(key + 1) % TransCacheSize].key = -1;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslations
+// 	Drop all cached translations, e.g., because we switched to a
+//	different address space.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslations()
+{
+    for (int i = 0; i < TransCacheSize; i++)
+	transCache[i].key = -1;
+}
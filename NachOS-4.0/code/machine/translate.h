@@ -42,4 +42,15 @@ class TranslationEntry {
 			// page is modified.
 };
 
+// The following class defines an entry in the simulator's own cache of
+// recent translations (see Machine::Translate).  This is host-side 
+// bookkeeping to make the simulation faster; it is not part of the 
+// simulated hardware, and the kernel never sees it.
+
+class TransCacheEntry {
+  public:
+    int key;		// (virtual page # << 1) | writing, or -1 if unused
+    int frameAddr;	// where the page starts in "mainMemory"
+};
+
 #endif
@@ -5,6 +5,7 @@ int main()
   char filename[100];
   char buffer[100];
   OpenFileId id;
+  int count;
 
   PrintString("Enter path: ");
   ReadString(filename, 100);
@@ -17,10 +18,9 @@ int main()
   }
   else
   {
-    while (Read(buffer, 100, id) > 0)
+    while ((count = Read(buffer, 100, id)) > 0)
     {
-      // PrintString(buffer);
-      Write(buffer, 100, ConsoleOutputId);
+      Write(buffer, count, ConsoleOutputId);
     }
   }
 
@@ -7,6 +7,7 @@ int main()
   char buffer[100];
   OpenFileId sourceId, destinationId;
   int createFileResult;
+  int count;
 
   PrintString("Enter source path: ");
   ReadString(sourcePath, 100);
@@ -32,8 +33,8 @@ int main()
 
   destinationId = Open(destinationPath);
 
-  while (Read(buffer, 100, sourceId) > 0)
-    Write(buffer, 100, destinationId);
+  while ((count = Read(buffer, 100, sourceId)) > 0)
+    Write(buffer, count, destinationId);
 
   Close(sourceId);
   Close(destinationId);
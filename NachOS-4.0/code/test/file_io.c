@@ -6,6 +6,7 @@ int main()
     int result;
     OpenFileId id;
     int i;
+    int count;
     char s[100];
 
     // PrintString("Enter file name: ");
@@ -32,13 +33,18 @@ int main()
     // Write to file
     PrintString("Enter a string to write to file: ");
     ReadString(s, 100);
-    Write(s, 100, id);
-    Write("\n", 100, id);
+    for (i = 0; s[i] != '\0'; i++)
+        ;
+    Write(s, i, id);
+    Write("\n", 1, id);
 
     Seek(0, id);
 
-    while (Read(s, 100, id) != 0)
+    while ((count = Read(s, 99, id)) != 0)
+    {
+        s[count] = '\0';
         PrintString(s);
+    }
 
     if (Remove(filename) == -1)
         PrintString("Remove file failed.\n");
@@ -5,13 +5,13 @@
 int main()
 {
   char buffer[SIZE];
+  int count;
 
   PrintString("Enter a string: ");
-  Read(buffer, SIZE, ConsoleInputId);
+  count = Read(buffer, SIZE, ConsoleInputId);
 
   PrintString("You entered: ");
-  Write(buffer, SIZE, ConsoleOutputId);
-  PrintString("\n");
+  Write(buffer, count, ConsoleOutputId);
 
   Halt();
 }
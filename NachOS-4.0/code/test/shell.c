@@ -1,13 +1,22 @@
 #include "syscall.h"
 
+#define MAX_ARGS 16
+
+/*
+ * A tiny shell: each line is a program name followed by its arguments.
+ * A line ending in "&" runs the program in the background, so that
+ * several programs run at once; otherwise the shell waits for it.
+ * "exit" (or end of input) leaves the shell.
+ */
 int
 main()
 {
   SpaceId newProc;
   OpenFileId input = ConsoleInputId;
   OpenFileId output = ConsoleOutputId;
-  char prompt[2], ch, buffer[60];
-  int i;
+  char prompt[2], buffer[60];
+  char *args[MAX_ARGS + 1];
+  int i, argc, background;
 
   prompt[0] = '-';
   prompt[1] = '-';
@@ -20,14 +29,43 @@ main()
 
     do {
 
-      Read(&buffer[i], 1, input);
+      if (Read(&buffer[i], 1, input) <= 0)
+        Exit(0);
+
+    } while (buffer[i] != '\n' && ++i < sizeof(buffer) - 1);
+
+    buffer[i] = '\0';
+
+    /* split the line into words */
+    argc = 0;
+    for (i = 0; buffer[i] != '\0' && argc < MAX_ARGS; ) {
+      while (buffer[i] == ' ')
+        buffer[i++] = '\0';
+      if (buffer[i] == '\0')
+        break;
+      args[argc++] = &buffer[i];
+      while (buffer[i] != ' ' && buffer[i] != '\0')
+        i++;
+    }
+
+    background = argc > 0 && args[argc - 1][0] == '&' && args[argc - 1][1] == '\0';
+    if (background)
+      argc--;
+    args[argc] = 0;
 
-    } while (buffer[i++] != '\n');
+    if (argc == 0)
+      continue;
 
-    buffer[--i] = '\0';
+    if (args[0][0] == 'e' && args[0][1] == 'x' && args[0][2] == 'i'
+        && args[0][3] == 't' && args[0][4] == '\0')
+      Exit(0);
 
-    if (i > 0) {
-      newProc = Exec(buffer);
+    newProc = ExecV(argc, args);
+    if (newProc < 0) {
+      PrintString("Unable to run ");
+      PrintString(args[0]);
+      PrintString("\n");
+    } else if (!background) {
       Join(newProc);
     }
   }
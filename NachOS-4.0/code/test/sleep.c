@@ -0,0 +1,19 @@
+#include "syscall.h"
+
+/*
+ * Sleep a few times, printing a dot each time.  Run it in the
+ * background from the shell ("sleep &") to see other programs run
+ * while it sleeps.
+ */
+int main()
+{
+  int i;
+
+  for (i = 0; i < 5; i++) {
+    Sleep(10000);
+    PrintChar('.');
+  }
+  PrintString("\n");
+
+  Exit(0);
+}
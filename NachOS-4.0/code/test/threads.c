@@ -0,0 +1,63 @@
+/* threads.c
+ *    Test program for user threads: matrix multiplication, as in
+ *    matmult.c, with the rows of the result split among a few threads
+ *    running in the same address space.
+ *
+ *    While one thread waits for a page fault, the others can run.
+ */
+
+#include "syscall.h"
+
+#define Dim 	20
+#define NumWorkers 	4
+
+int A[Dim][Dim];
+int B[Dim][Dim];
+int C[Dim][Dim];
+
+/* Compute every NumWorkers'th row of the result, starting at "first". */
+void
+Rows(int first)
+{
+    int i, j, k;
+
+    for (i = first; i < Dim; i += NumWorkers)
+	for (j = 0; j < Dim; j++)
+            for (k = 0; k < Dim; k++)
+		 C[i][j] += A[i][k] * B[k][j];
+}
+
+/* A forked procedure takes no arguments, so each worker has its own. */
+void Worker0() { Rows(0); }
+void Worker1() { Rows(1); }
+void Worker2() { Rows(2); }
+void Worker3() { Rows(3); ThreadExit(0); }	/* same as returning */
+
+int
+main()
+{
+    ThreadId workers[NumWorkers];
+    int i, j;
+
+    for (i = 0; i < Dim; i++)		/* first initialize the matrices */
+	for (j = 0; j < Dim; j++) {
+	     A[i][j] = i;
+	     B[i][j] = j;
+	     C[i][j] = 0;
+	}
+
+    workers[0] = ThreadFork(Worker0);	/* then multiply them together */
+    workers[1] = ThreadFork(Worker1);
+    workers[2] = ThreadFork(Worker2);
+    workers[3] = ThreadFork(Worker3);
+    for (i = 0; i < NumWorkers; i++) {
+	if (workers[i] < 0 || ThreadJoin(workers[i]) != 0) {
+	    PrintString("Thread failed\n");
+	    Exit(1);
+	}
+    }
+
+    PrintNum(C[Dim-1][Dim-1]);		/* should be 7220 */
+    PrintString("\n");
+    Exit(0);
+}
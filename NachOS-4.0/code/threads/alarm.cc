@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and putting threads to sleep
+//	for a while.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -12,17 +11,37 @@
 #include "alarm.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// SleeperCompare
+// 	Compare two sleepers by wake-up time, for the sorted list of them.
+//----------------------------------------------------------------------
+
+static int
+SleeperCompare(Sleeper *x, Sleeper *y)
+{
+    if (x->when < y->when) return -1;
+    else if (x->when == y->when) return 0;
+    else return 1;
+}
+
 //----------------------------------------------------------------------
 // Alarm::Alarm
 //      Initialize a software alarm clock.  Start up a timer device
 //
+//	The timer interrupts once per time slice of the scheduling policy,
+//	so the scheduler must be initialized first.
+//
 //      "doRandom" -- if true, arrange for the hardware interrupts to 
 //		occur at random, instead of fixed, intervals.
+//	"tickless" -- if true, turn the timer off while it has nothing
+//		to do
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom)
+Alarm::Alarm(bool doRandom, bool tickless)
 {
-    timer = new Timer(doRandom, this);
+    ticklessMode = tickless;
+    timer = new Timer(doRandom, this, kernel->scheduler->getQuantum());
+    sleepers = new SortedList<Sleeper *>(SleeperCompare);
 }
 
 //----------------------------------------------------------------------
@@ -39,8 +58,17 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	First, wake up every sleeping thread whose time has come.  Then
+//	time-slice: only need to time slice if we're currently running 
+//	something (in other words, not idle), and then only if the 
+//	scheduling policy says so, or if the thread has been killed, so
+//	that it exits (see ExceptionHandler).
+//
+//	In tickless mode, if there is nobody to time-slice with, nobody
+//	to wake up, and no preemption was just requested (a killed thread
+//	still has to get to ExceptionHandler to exit), turn the timer off
+//	after this interrupt.  It is turned back on when a thread becomes
+//	ready, or goes to sleep.
 //----------------------------------------------------------------------
 
 void 
@@ -48,8 +76,73 @@ Alarm::CallBack()
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
+    Sleeper *sleeper;
+    bool preempt = FALSE;
+
+    while (!sleepers->IsEmpty()
+		&& sleepers->Front()->when <= kernel->stats->totalTicks) {
+	sleeper = sleepers->RemoveFront();
+	DEBUG(dbgThread, "Waking up thread: " << sleeper->thread->getName());
+	kernel->scheduler->ReadyToRun(sleeper->thread);
+    }
     
-    if (status != IdleMode) {
+    if (status != IdleMode && (kernel->scheduler->ShouldPreempt()
+    			|| kernel->currentThread->killed)) {
 	interrupt->YieldOnReturn();
+	preempt = TRUE;
+    }
+
+    if (ticklessMode && !preempt && sleepers->IsEmpty()
+		&& kernel->scheduler->NumReady() == 0) {
+	DEBUG(dbgInt, "Turning the timer off");
+	timer->Disable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::StartTicking
+// 	Called when a thread becomes ready to run, or goes to sleep: make
+//	sure the timer is on, in case tickless mode turned it off.  The
+//	next interrupt comes a full time slice from now (unless one was
+//	already on its way).  Interrupts must be disabled.
+//----------------------------------------------------------------------
+
+void
+Alarm::StartTicking()
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (ticklessMode) {
+	timer->Enable();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep until simulated time has advanced
+//	by at least "x" ticks.  It is woken up by the first timer interrupt
+//	after that; meanwhile, it is not on the ready list, and costs the
+//	scheduler nothing.
+//
+//	"x" -- how long to sleep, in ticks; nothing happens if it is not
+//		positive
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    IntStatus oldLevel;
+    Thread *thread = kernel->currentThread;
+    Sleeper sleeper(thread, kernel->stats->totalTicks + x);
+
+    if (x <= 0) {
+	return;
     }
+    oldLevel = kernel->interrupt->SetLevel(IntOff);
+    DEBUG(dbgThread, "Thread " << thread->getName() << " sleeping until "
+    		<< sleeper.when);
+    sleepers->Insert(&sleeper);
+    StartTicking();
+    thread->Sleep(FALSE);
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
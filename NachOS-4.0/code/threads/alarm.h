@@ -8,7 +8,15 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	A thread waiting for its delay to pass is not on the ready list;
+//	it sleeps on a list of sleepers sorted by wake-up time, and the
+//	timer interrupt puts it back on the ready list.  So a delay is
+//	rounded up to the next timer interrupt.
+//
+//	The timer interrupts once per time slice of the scheduling
+//	policy.  In "tickless" mode, it is turned off while there is no
+//	point to it -- nobody else is ready to run, and nobody sleeps --
+//	so that a thread running alone is not interrupted for nothing.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,19 +29,39 @@
 #include "utility.h"
 #include "callback.h"
 #include "timer.h"
+#include "list.h"
+
+class Thread;
+
+// The following class defines a thread waiting in WaitUntil.
+
+class Sleeper {
+  public:
+    Sleeper(Thread *t, int wakeTime) { thread = t; when = wakeTime; }
+
+    Thread *thread;		// the sleeping thread
+    int when;			// when to wake it up
+};
 
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
+    Alarm(bool doRandomYield, bool tickless);
+    				// Initialize the timer, and callback 
 				// to "toCall" every time slice.
-    ~Alarm() { delete timer; }
+    ~Alarm() { delete timer; delete sleepers; }
     
     void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
+    bool HasSleepers() { return !sleepers->IsEmpty(); }
+    				// Is any thread waiting for time to pass?
+    void StartTicking();	// The timer may be needed; turn it on if
+    				// it is off
 
   private:
     Timer *timer;		// the hardware timer device
+    bool ticklessMode;		// turn the timer off when not needed?
+    SortedList<Sleeper *> *sleepers;	// threads in WaitUntil, the
+    					// earliest to wake up first
 
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
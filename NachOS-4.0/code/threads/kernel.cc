@@ -16,7 +16,12 @@
 #include "string.h"
 #include "synchconsole.h"
 #include "synchdisk.h"
+#include "sectorcache.h"
 #include "post.h"
+#include "frametable.h"
+#include "swap.h"
+#include "ptable.h"
+#include "stackpool.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -31,6 +36,14 @@ Kernel::Kernel(int argc, char** argv)
 
     randomSlice = FALSE;
     debugUserProg = FALSE;
+    execEngine = SwitchEngine;
+    lruReplacement = FALSE;
+    schedType = FifoScheduling;
+    quantum = 0;
+    tickless = FALSE;
+    stackWords = StackSize;
+    stackPoolSize = StackPoolSize;
+    blockIdle = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
 #ifndef FILESYS_STUB
@@ -50,6 +63,68 @@ Kernel::Kernel(int argc, char** argv)
         else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
         }
+        else if (strcmp(argv[i], "-e") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "threaded") == 0) {
+                execEngine = ThreadedEngine;
+            } else if (strcmp(argv[i + 1], "block") == 0) {
+                execEngine = BlockEngine;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "switch") == 0);
+                execEngine = SwitchEngine;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "-vm") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "lru") == 0) {
+                lruReplacement = TRUE;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "clock") == 0);
+                lruReplacement = FALSE;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "-sched") == 0) {
+            ASSERT(i + 1 < argc);
+            if (strcmp(argv[i + 1], "mlfq") == 0) {
+                schedType = FeedbackScheduling;
+            } else if (strcmp(argv[i + 1], "priority") == 0) {
+                schedType = PriorityScheduling;
+            } else if (strcmp(argv[i + 1], "lottery") == 0) {
+                schedType = LotteryScheduling;
+            } else if (strcmp(argv[i + 1], "stride") == 0) {
+                schedType = StrideScheduling;
+            } else {
+                ASSERT(strcmp(argv[i + 1], "fifo") == 0);
+                schedType = FifoScheduling;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "-quantum") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is int
+            quantum = atoi(argv[i + 1]);
+            ASSERT(quantum > 0);
+            i++;
+        }
+        else if (strcmp(argv[i], "-tickless") == 0) {
+            tickless = TRUE;
+        }
+        else if (strcmp(argv[i], "-stack") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is int
+            stackWords = atoi(argv[i + 1]);
+            ASSERT(stackWords >= 1024);
+            i++;
+        }
+        else if (strcmp(argv[i], "-stackpool") == 0) {
+            ASSERT(i + 1 < argc);   // next argument is int
+            stackPoolSize = atoi(argv[i + 1]);
+            ASSERT(stackPoolSize >= 0);
+            i++;
+        }
+        else if (strcmp(argv[i], "-ib") == 0) {
+            blockIdle = TRUE;
+        }
         else if (strcmp(argv[i], "-ci") == 0) {
             ASSERT(i + 1 < argc);
             consoleIn = argv[i + 1];
@@ -77,7 +152,11 @@ Kernel::Kernel(int argc, char** argv)
         }
         else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-            cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-s] [-e switch|threaded|block]\n";
+            cout << "Partial usage: nachos [-vm clock|lru] [-ib]\n";
+            cout << "Partial usage: nachos [-sched fifo|mlfq|priority|lottery|stride]\n";
+            cout << "Partial usage: nachos [-quantum #] [-tickless]\n";
+            cout << "Partial usage: nachos [-stack #] [-stackpool #]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-nf]\n";
@@ -104,13 +183,42 @@ Kernel::Initialize()
     currentThread->setStatus(RUNNING);
 
     stats = new Statistics();		// collect statistics
-    interrupt = new Interrupt;		// start up interrupt handling
-    scheduler = new Scheduler();	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    stackPool = new StackPool(stackWords, stackPoolSize);
+    					// stacks for forked threads
+    interrupt = new Interrupt(blockIdle);	// start up interrupt handling
+    switch (schedType) {		// initialize the ready queue
+      case FeedbackScheduling:
+        scheduler = new Scheduler(new FeedbackPolicy());
+        break;
+      case PriorityScheduling:
+        scheduler = new Scheduler(new PriorityPolicy());
+        break;
+      case LotteryScheduling:
+        scheduler = new Scheduler(new LotteryPolicy());
+        break;
+      case StrideScheduling:
+        scheduler = new Scheduler(new StridePolicy());
+        break;
+      default:
+        scheduler = new Scheduler(new FifoPolicy());
+        break;
+    }
+    if (quantum > 0) {
+        scheduler->setQuantum(quantum);
+    }
+    alarm = new Alarm(randomSlice, tickless);	// start up time slicing
+    machine = new Machine(debugUserProg, execEngine);
+    if (lruReplacement) {
+        frameTable = new FrameTable(new AgingPolicy());
+    } else {
+        frameTable = new FrameTable(new ClockPolicy());
+    }
+    swapSpace = new SwapSpace();
+    processTable = new ProcessTable();
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
     synchDisk = new SynchDisk();    //
+    sectorCache = new SectorCache();
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
@@ -122,6 +230,23 @@ Kernel::Initialize()
     interrupt->Enable();
 }
 
+//----------------------------------------------------------------------
+// Kernel::Shutdown
+// 	Called when Nachos halts, while the devices still work: write 
+//	what every open file has buffered, and then everything in the
+//	sector cache, to disk.  Not done by ~Kernel, which also runs
+//	when the user hits ctl-C, in the middle of who knows what.
+//----------------------------------------------------------------------
+
+void
+Kernel::Shutdown()
+{
+#ifndef FILESYS_STUB
+    OpenFile::SyncAll();		// before the cache is flushed
+#endif
+    sectorCache->Flush();
+}
+
 //----------------------------------------------------------------------
 // Kernel::~Kernel
 // 	Nachos is halting.  De-allocate global data structures.
@@ -133,9 +258,14 @@ Kernel::~Kernel()
     delete interrupt;
     delete scheduler;
     delete alarm;
+    delete stackPool;
     delete machine;
+    delete frameTable;
+    delete swapSpace;
+    delete processTable;
     delete synchConsoleIn;
     delete synchConsoleOut;
+    delete sectorCache;
     delete synchDisk;
     delete fileSystem;
     delete postOfficeIn;
@@ -158,6 +288,8 @@ Kernel::ThreadSelfTest() {
 
     currentThread->SelfTest();	// test thread switching
 
+    scheduler->SelfTest();	// test the scheduling policies
+
                  // test semaphore operation
     semaphore = new Semaphore("test", 0);
     semaphore->SelfTest();
@@ -24,12 +24,20 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class SectorCache;
+class FrameTable;
+class SwapSpace;
+class ProcessTable;
+class StackPool;
 
 class Kernel {
   public:
     Kernel(int argc, char **argv);
     				// Interpret command line arguments
     ~Kernel();		        // deallocate the kernel
+
+    void Shutdown();		// Nachos is about to halt: put everything
+    				// that must survive on disk
     
     void Initialize(); 		// initialize the kernel -- separated
 				// from constructor because 
@@ -46,6 +54,7 @@ class Kernel {
 
     Thread *currentThread;	// the thread holding the CPU
     Scheduler *scheduler;	// the ready list
+    StackPool *stackPool;	// execution stacks for new threads
     Interrupt *interrupt;	// interrupt status
     Statistics *stats;		// performance metrics
     Alarm *alarm;		// the software alarm clock    
@@ -53,7 +62,11 @@ class Kernel {
     SynchConsoleInput *synchConsoleIn;
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
+    SectorCache *sectorCache;	// recently used disk sectors
     FileSystem *fileSystem;     
+    FrameTable *frameTable;	// physical page frames of user memory
+    SwapSpace *swapSpace;	// backing store for modified user pages
+    ProcessTable *processTable;	// the user programs that are running
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
 
@@ -62,6 +75,14 @@ class Kernel {
   private:
     bool randomSlice;		// enable pseudo-random time slicing
     bool debugUserProg;         // single step user program
+    ExecEngine execEngine;      // how the simulator runs user code
+    bool lruReplacement;	// page replacement: aging if TRUE, else clock
+    SchedulingType schedType;	// how to choose the next thread to run
+    int quantum;		// time slice, or 0 for the policy's own
+    bool tickless;		// turn the timer off when it is not needed
+    int stackWords;		// size of a thread's stack, in words
+    int stackPoolSize;		// how many stacks to keep for reuse
+    bool blockIdle;		// wait for host input when idle
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
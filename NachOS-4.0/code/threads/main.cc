@@ -3,8 +3,11 @@
 //	operating system kernel.  
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
-//              -f -cp <unix file> <nachos file>
+//              -s -e <engine> -vm <policy> -sched <policy>
+//              -quantum <ticks> -tickless -stack <words>
+//              -stackpool <stacks> -ib -x <nachos file>
+//              -ci <consoleIn> -co <consoleOut>
+//              -f -cp <unix file> <nachos file> -mkdir <nachos dir>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
 //              -z -K -C -N
@@ -13,21 +16,40 @@
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
-//    -x runs a user program
+//    -e selects how the simulator executes user instructions: "switch"
+//       (the default), "threaded", or "block" (fastest); the results,
+//       including simulated time, are identical
+//    -vm selects the page replacement policy for user memory: "clock"
+//       (the default) or "lru" (an approximation by aging)
+//    -sched selects the thread scheduling policy: "fifo" (round robin,
+//       the default), "mlfq" (multilevel feedback queues), "priority"
+//       (strict priority, with aging), "lottery", or "stride"
+//    -quantum sets the time slice, in ticks, instead of the policy's own
+//    -tickless turns the timer off while only one thread wants the CPU
+//       (and none is sleeping), so that it is not interrupted for nothing
+//    -stack sets the size of every thread's stack, in words
+//    -stackpool sets how many stacks of finished threads are kept, to
+//       be reused by threads forked later (0 turns the pool off)
+//    -ib makes an idle Nachos wait in the host OS for console or network
+//       input, instead of simulating device polls until it arrives
+//    -x runs a user program; it may Exec others, and Nachos halts
+//       when the last of them exits
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
-//    -K run a simple self test of kernel threads and synchronization
+//    -K run a simple self test of kernel threads and synchronization,
+//       and show how each scheduling policy shares the CPU
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
 //    -cp copies a file from UNIX to Nachos
+//    -mkdir creates a Nachos directory (before any -cp)
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -l lists the contents of the Nachos directories
 //    -D prints the contents of the entire file system 
 //
 //  Note: the file system flags are not used if the stub filesystem
@@ -45,6 +67,7 @@
 #include "filesys.h"
 #include "openfile.h"
 #include "sysdep.h"
+#include "ptable.h"
 
 // global variables
 Kernel *kernel;
@@ -177,6 +200,7 @@ main(int argc, char **argv)
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
     char *printFileName = NULL; 
     char *removeFileName = NULL;
+    char *makeDirName = NULL;
     bool dirListFlag = false;
     bool dumpFlag = false;
 #endif //FILESYS_STUB
@@ -224,6 +248,11 @@ main(int argc, char **argv)
 	    removeFileName = argv[i + 1];
 	    i++;
 	}
+	else if (strcmp(argv[i], "-mkdir") == 0) {
+	    ASSERT(i + 1 < argc);
+	    makeDirName = argv[i + 1];
+	    i++;
+	}
 	else if (strcmp(argv[i], "-l") == 0) {
 	    dirListFlag = true;
 	}
@@ -237,6 +266,7 @@ main(int argc, char **argv)
 	    cout << "Partial usage: nachos [-K] [-C] [-N]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
+            cout << "Partial usage: nachos [-mkdir NachosDirectory]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
             cout << "Partial usage: nachos [-l] [-D]\n";
 #endif //FILESYS_STUB
@@ -269,6 +299,9 @@ main(int argc, char **argv)
     if (removeFileName != NULL) {
       kernel->fileSystem->Remove(removeFileName);
     }
+    if (makeDirName != NULL) {
+      kernel->fileSystem->CreateDirectory(makeDirName);
+    }
     if (copyUnixFileName != NULL && copyNachosFileName != NULL) {
       Copy(copyUnixFileName,copyNachosFileName);
     }
@@ -288,6 +321,7 @@ main(int argc, char **argv)
       AddrSpace *space = new AddrSpace;
       ASSERT(space != (AddrSpace *)NULL);
       if (space->Load(userProgName)) {  // load the program into the space
+	kernel->processTable->Attach(userProgName, space);
 	space->Execute();              // run the program
 	ASSERTNOTREACHED();            // Execute never returns
       }
@@ -11,8 +11,11 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+//	Which thread runs next is up to the scheduling policy; the
+//	policies are at the end of this file.  The scheduler itself
+//	keeps track of how long each thread runs and waits: a thread is
+//	charged for the time since it started running (or was last 
+//	charged) at every timer interrupt, and when it stops running.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,17 +24,22 @@
 #include "copyright.h"
 #include "debug.h"
 #include "scheduler.h"
+#include "synch.h"
 #include "main.h"
 
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
 //	Initially, no ready threads.
+//
+//	"schedPolicy" -- how to choose the next thread to run.  Deleted
+//		along with the scheduler.
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedulingPolicy *schedPolicy)
 { 
-    readyList = new List<Thread *>; 
+    policy = schedPolicy;
+    numReady = 0;
     toBeDestroyed = NULL;
 } 
 
@@ -42,13 +50,16 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    delete policy; 
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on the ready list, for later scheduling onto the CPU,
+//	and start counting the time it waits there.  There may be more
+//	than one thread wanting the CPU now, so the timer has to run, 
+//	even in tickless mode.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -60,13 +71,17 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append(thread);
+    thread->readySince = kernel->stats->totalTicks;
+    policy->Add(thread);
+    numReady++;
+    kernel->alarm->StartTicking();
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
-//	If there are no ready threads, return NULL.
+// 	Return the next thread to be scheduled onto the CPU, as chosen
+//	by the scheduling policy.  If there are no ready threads, return
+//	NULL.
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -76,11 +91,12 @@ Scheduler::FindNextToRun ()
 {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
-	return NULL;
-    } else {
-    	return readyList->RemoveFront();
+    Thread *thread = policy->Remove();
+
+    if (thread != NULL) {
+	numReady--;
     }
+    return thread;
 }
 
 //----------------------------------------------------------------------
@@ -91,6 +107,7 @@ Scheduler::FindNextToRun ()
 //
 //      Note: we assume the state of the previously running thread has
 //	already been changed from running to blocked or ready (depending).
+//	It is charged for the time it ran; the next thread stops waiting.
 // Side effect:
 //	The global variable kernel->currentThread becomes nextThread.
 //
@@ -120,6 +137,10 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    Account(oldThread);
+    nextThread->waitTicks += kernel->stats->totalTicks - nextThread->readySince;
+    nextThread->runSince = kernel->stats->totalTicks;
+
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
     
@@ -161,6 +182,9 @@ void
 Scheduler::CheckToBeDestroyed()
 {
     if (toBeDestroyed != NULL) {
+	DEBUG(dbgThread, "Thread " << toBeDestroyed->getName() << " ran "
+		<< toBeDestroyed->runTicks << " ticks, waited "
+		<< toBeDestroyed->waitTicks << " ticks");
         delete toBeDestroyed;
 	toBeDestroyed = NULL;
     }
@@ -174,6 +198,487 @@ Scheduler::CheckToBeDestroyed()
 void
 Scheduler::Print()
 {
-    cout << "Ready list contents:\n";
-    readyList->Apply(ThreadPrint);
+    cout << "Ready list contents (" << policy->getName() << "):\n";
+    policy->Print();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ShouldPreempt
+// 	Called at every timer interrupt, while a thread is running: charge
+//	it for its time so far, and ask the policy whether it should 
+//	yield the CPU.  With nobody ready to run, there is no point.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::ShouldPreempt()
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    Account(kernel->currentThread);
+    return numReady > 0 && policy->ShouldPreempt(kernel->currentThread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Account
+// 	Charge the running thread for the time since it started running,
+//	or was last charged, and tell the policy.
+//
+//	"thread" -- the running thread
+//----------------------------------------------------------------------
+
+void
+Scheduler::Account(Thread *thread)
+{
+    int ticks = kernel->stats->totalTicks - thread->runSince;
+
+    thread->runTicks += ticks;
+    thread->runSince = kernel->stats->totalTicks;
+    policy->Charge(thread, ticks);
+}
+
+// The threads run by Scheduler::SelfTest: one of low, one of medium,
+// and one of high priority, each counting how long it got to run.
+
+class SchedTestThread {
+  public:
+    char name[8];
+    int priority;
+    int order;			// when it first ran, among the three
+    int loops;			// how many times around its loop
+};
+
+static SchedTestThread schedTest[] = {
+    { "low", 0, 0, 0 }, { "medium", 3, 0, 0 }, { "high", 8, 0, 0 }
+};
+const int NumSchedTestThreads = 3;
+
+static int schedTestStarted;		// how many have run so far
+static int schedTestEnd;		// when they all stop
+static Semaphore *schedTestDone;	// signalled as each one stops
+
+//----------------------------------------------------------------------
+// SchedTestLoop
+// 	The body of each thread of the scheduler self test: keep the CPU
+//	busy until the test is over, letting simulated time pass (and so
+//	the timer go off) every time around.  Each time around takes the
+//	same time, so the count of loops is the thread's share.
+//
+//	"arg" -- the thread's SchedTestThread
+//----------------------------------------------------------------------
+
+static void
+SchedTestLoop(void *arg)
+{
+    SchedTestThread *test = (SchedTestThread *) arg;
+
+    test->order = schedTestStarted++;
+    while (kernel->stats->totalTicks < schedTestEnd) {
+	test->loops++;
+	(void) kernel->interrupt->SetLevel(IntOff);
+	(void) kernel->interrupt->SetLevel(IntOn);
+    }
+
+    // nothing may run between telling the test we are done, and being
+    // gone, so that we are not left on the ready list of the policy
+    (void) kernel->interrupt->SetLevel(IntOff);
+    schedTestDone->V();
+    kernel->currentThread->Finish();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SelfTest
+// 	Run three compute-bound threads, of priority 0, 3 and 8 (so
+//	holding 1, 4 and 9 lottery tickets), under each policy in turn,
+//	for 200 time slices.  Print the order in which they first ran, and
+//	the share of the CPU each got.
+//
+//	Round robin and feedback queues should share the CPU evenly, in
+//	the order the threads were forked.  Priority should run the high
+//	priority thread first, and most of the time; aging gives the other
+//	two a little.  Lottery and stride should share it 1:4:9, lottery
+//	only roughly.
+//
+//	The policy is switched while nobody is ready to run, and put back
+//	at the end.  The timer keeps interrupting as often as the kernel's
+//	own policy asked, so every policy is tested with that quantum.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SelfTest()
+{
+    SchedulingPolicy *policies[] = { new FifoPolicy(), new FeedbackPolicy(),
+    				new PriorityPolicy(), new LotteryPolicy(),
+				new StridePolicy() };
+    const int numPolicies = sizeof(policies) / sizeof(policies[0]);
+    SchedulingPolicy *saved = policy;
+    int total;
+
+    DEBUG(dbgThread, "Entering Scheduler::SelfTest");
+    schedTestDone = new Semaphore("scheduler test", 0);
+
+    for (int p = 0; p < numPolicies; p++) {
+	ASSERT(numReady == 0);
+	policy = policies[p];
+	policy->setQuantum(saved->getQuantum());
+	schedTestStarted = 0;
+	schedTestEnd = kernel->stats->totalTicks + 200 * policy->getQuantum();
+	for (int i = 0; i < NumSchedTestThreads; i++) {
+	    Thread *t = new Thread(schedTest[i].name);
+
+	    schedTest[i].loops = 0;
+	    t->setPriority(schedTest[i].priority);
+	    t->Fork(SchedTestLoop, (void *) &schedTest[i]);
+	}
+	for (int i = 0; i < NumSchedTestThreads; i++) {
+	    schedTestDone->P();
+	}
+
+	total = 0;
+	for (int i = 0; i < NumSchedTestThreads; i++) {
+	    total += schedTest[i].loops;
+	}
+	cout << "*** " << policy->getName() << ":";
+	for (int i = 0; i < NumSchedTestThreads; i++) {
+	    cout << " " << schedTest[i].name << " ran #"
+	    	<< schedTest[i].order + 1 << ", "
+		<< schedTest[i].loops * 100 / total << "%";
+	}
+	cout << "\n";
+
+	ASSERT(numReady == 0);
+	policy = saved;
+	delete policies[p];
+    }
+    delete schedTestDone;
+}
+
+//----------------------------------------------------------------------
+// FifoPolicy::Remove
+// 	Return the thread that has been ready the longest.
+//----------------------------------------------------------------------
+
+Thread *
+FifoPolicy::Remove()
+{
+    if (readyList->IsEmpty()) {
+	return NULL;
+    } else {
+    	return readyList->RemoveFront();
+    }
+}
+
+// How often (in quanta) every waiting thread goes back to the top queue.
+const int FeedbackBoostQuanta = 100;
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::FeedbackPolicy
+// 	Initialize the feedback queues, all empty.
+//----------------------------------------------------------------------
+
+FeedbackPolicy::FeedbackPolicy() : SchedulingPolicy(TimerTicks / 2)
+{
+    for (int i = 0; i < NumFeedbackLevels; i++) {
+	queues[i] = new List<Thread *>;
+    }
+    lastBoost = 0;
+}
+
+FeedbackPolicy::~FeedbackPolicy()
+{
+    for (int i = 0; i < NumFeedbackLevels; i++) {
+	delete queues[i];
+    }
+}
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::Quantum
+// 	Return the time slice of a level: the quantum at the top, twice
+//	as long at every level below.
+//
+//	"level" -- the level
+//----------------------------------------------------------------------
+
+int
+FeedbackPolicy::Quantum(int level)
+{
+    return quantum << level;
+}
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::Add
+// 	Put a ready thread at the end of the queue for its level.  If it
+//	has used up its time slice, it moves down a level first; blocking
+//	before the slice is up does not start a new one, so a thread does
+//	not get to stay at the top by yielding just in time.
+//
+//	A thread that has not run since the last boost moves to the top.
+//
+//	"thread" -- the thread that is ready
+//----------------------------------------------------------------------
+
+void
+FeedbackPolicy::Add(Thread *thread)
+{
+    if (thread->runSince < lastBoost) {
+	thread->level = 0;
+	thread->quantumUsed = 0;
+    } else if (thread->quantumUsed >= Quantum(thread->level)) {
+	if (thread->level < NumFeedbackLevels - 1) {
+	    thread->level++;
+	    DEBUG(dbgThread, "Thread " << thread->getName()
+	    		<< " moves down to level " << thread->level);
+	}
+	thread->quantumUsed = 0;
+    }
+    queues[thread->level]->Append(thread);
+}
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::Remove
+// 	Return the first thread in the highest non-empty queue, after
+//	boosting every thread, if it is time to.
+//----------------------------------------------------------------------
+
+Thread *
+FeedbackPolicy::Remove()
+{
+    int sinceBoost = kernel->stats->totalTicks - lastBoost;
+
+    if (sinceBoost >= FeedbackBoostQuanta * quantum) {
+	Boost();
+    }
+    for (int i = 0; i < NumFeedbackLevels; i++) {
+	if (!queues[i]->IsEmpty()) {
+	    return queues[i]->RemoveFront();
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::ShouldPreempt
+// 	The running thread yields when its time slice is up, or when a
+//	thread in a higher queue is ready.
+//
+//	"thread" -- the running thread
+//----------------------------------------------------------------------
+
+bool
+FeedbackPolicy::ShouldPreempt(Thread *thread)
+{
+    if (thread->quantumUsed >= Quantum(thread->level)) {
+	return TRUE;
+    }
+    for (int i = 0; i < thread->level; i++) {
+	if (!queues[i]->IsEmpty()) {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::Boost
+// 	Move every ready thread to the top queue, with a fresh time slice.
+//	Blocked threads are moved when they become ready (see Add).
+//----------------------------------------------------------------------
+
+void
+FeedbackPolicy::Boost()
+{
+    Thread *thread;
+
+    DEBUG(dbgThread, "Moving every waiting thread to the top queue");
+    lastBoost = kernel->stats->totalTicks;
+    for (int i = 1; i < NumFeedbackLevels; i++) {
+	while (!queues[i]->IsEmpty()) {
+	    thread = queues[i]->RemoveFront();
+	    thread->level = 0;
+	    thread->quantumUsed = 0;
+	    queues[0]->Append(thread);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// FeedbackPolicy::Print
+// 	Print the ready threads, level by level.
+//----------------------------------------------------------------------
+
+void
+FeedbackPolicy::Print()
+{
+    for (int i = 0; i < NumFeedbackLevels; i++) {
+	cout << "Level " << i << ": ";
+	queues[i]->Apply(ThreadPrint);
+	cout << "\n";
+    }
+}
+
+// How long (in quanta) a thread waits for its priority to go up by one.
+const int AgingQuanta = 5;
+
+//----------------------------------------------------------------------
+// PriorityPolicy::Effective
+// 	Return the priority of a ready thread, raised by one for every
+//	AgingQuanta time slices it has been waiting.
+//
+//	"thread" -- a ready thread
+//----------------------------------------------------------------------
+
+int
+PriorityPolicy::Effective(Thread *thread)
+{
+    int waited = kernel->stats->totalTicks - thread->readySince;
+    int priority = thread->getPriority() + waited / (AgingQuanta * quantum);
+
+    return (priority > MaxPriority) ? MaxPriority : priority;
+}
+
+//----------------------------------------------------------------------
+// PriorityPolicy::Best
+// 	Return the ready thread with the highest effective priority, the
+//	one that has waited longest if there is a tie; or NULL.
+//----------------------------------------------------------------------
+
+Thread *
+PriorityPolicy::Best()
+{
+    Thread *best = NULL;
+
+    ListIterator<Thread *> iter(readyList);
+    for (; !iter.IsDone(); iter.Next()) {
+	if (best == NULL || Effective(iter.Item()) > Effective(best)) {
+	    best = iter.Item();
+	}
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// PriorityPolicy::Remove
+// 	Return the ready thread with the highest effective priority.
+//----------------------------------------------------------------------
+
+Thread *
+PriorityPolicy::Remove()
+{
+    Thread *best = Best();
+
+    if (best != NULL) {
+	readyList->Remove(best);
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// PriorityPolicy::ShouldPreempt
+// 	The running thread yields if a ready thread has at least its 
+//	priority (so that threads of the same priority take turns).
+//
+//	"thread" -- the running thread
+//----------------------------------------------------------------------
+
+bool
+PriorityPolicy::ShouldPreempt(Thread *thread)
+{
+    Thread *best = Best();
+
+    return best != NULL && Effective(best) >= thread->getPriority();
+}
+
+//----------------------------------------------------------------------
+// LotteryPolicy::Remove
+// 	Draw a ticket, and return the ready thread holding it.  Every
+//	thread holds priority + 1 tickets.
+//----------------------------------------------------------------------
+
+Thread *
+LotteryPolicy::Remove()
+{
+    int tickets = 0;
+    int winner;
+
+    if (readyList->IsEmpty()) {
+	return NULL;
+    }
+    ListIterator<Thread *> count(readyList);
+    for (; !count.IsDone(); count.Next()) {
+	tickets += count.Item()->getPriority() + 1;
+    }
+    winner = RandomNumber() % tickets;
+
+    ListIterator<Thread *> iter(readyList);
+    for (; !iter.IsDone(); iter.Next()) {
+	winner -= iter.Item()->getPriority() + 1;
+	if (winner < 0) {
+	    break;
+	}
+    }
+    readyList->Remove(iter.Item());
+    return iter.Item();
+}
+
+// Stride scheduling: a thread with t tickets advances its pass by 
+// StrideScale / t for every quantum it runs.  StrideScale is a
+// multiple of every ticket count from 1 to MaxPriority + 1.
+const int StrideScale = 2520;
+
+//----------------------------------------------------------------------
+// StridePolicy::Add
+// 	Put a ready thread on the ready list.  A thread that has been 
+//	blocked for a while cannot make up for it by running until it 
+//	catches up: its pass starts no earlier than the present.
+//
+//	"thread" -- the thread that is ready
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Add(Thread *thread)
+{
+    if (thread->pass < virtualTime) {
+	thread->pass = virtualTime;
+    }
+    readyList->Append(thread);
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Remove
+// 	Return the ready thread with the smallest pass, the one that has
+//	waited longest if there is a tie.
+//----------------------------------------------------------------------
+
+Thread *
+StridePolicy::Remove()
+{
+    Thread *next = NULL;
+
+    ListIterator<Thread *> iter(readyList);
+    for (; !iter.IsDone(); iter.Next()) {
+	if (next == NULL || iter.Item()->pass < next->pass) {
+	    next = iter.Item();
+	}
+    }
+    if (next != NULL) {
+	readyList->Remove(next);
+	virtualTime = next->pass;
+    }
+    return next;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Charge
+// 	Advance the pass of a thread that has run.
+//
+//	"thread" -- the thread that ran
+//	"ticks" -- for how long
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Charge(Thread *thread, int ticks)
+{
+    int stride = StrideScale / (thread->getPriority() + 1);
+
+    thread->quantumUsed += ticks;
+    thread->pass += stride * ticks / quantum;
 }
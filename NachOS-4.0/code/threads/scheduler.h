@@ -1,9 +1,15 @@
-// scheduler.h 
+// scheduler.h
 //	Data structures for the thread dispatcher and scheduler.
 //	Primarily, the list of threads that are ready to run.
 //
+//	Which ready thread runs next, and when the running thread should
+//	give up the CPU at a timer interrupt, is up to a scheduling policy,
+//	chosen when the kernel starts up (see the -sched flag in
+//	kernel.cc).  The scheduler keeps track of how long each thread has
+//	run and waited, for the policy to go by.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #ifndef SCHEDULER_H
@@ -11,34 +17,216 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "stats.h"
 #include "thread.h"
 
-// The following class defines the scheduler/dispatcher abstraction -- 
-// the data structures and operations needed to keep track of which 
+// The scheduling policies to choose from.
+
+enum SchedulingType { FifoScheduling,	// round robin, the original
+		      FeedbackScheduling,// multilevel feedback queues
+		      PriorityScheduling,// strict priority, with aging
+		      LotteryScheduling,// random, in proportion to priority
+		      StrideScheduling	// deterministic proportional share
+};
+
+// The following class defines the interface to a scheduling policy.
+// All of it is called with interrupts off.  Add and Remove keep the
+// threads that are ready to run; Charge and ShouldPreempt are told
+// about the running thread.
+//
+// Each policy has a time slice, the "quantum": the timer interrupts
+// that often (see Alarm), and that is when ShouldPreempt is asked.
+// Each policy passes its own default to the constructor; -quantum
+// overrides it.  Anything else a policy measures in time (aging,
+// boosting, stride passes) is in quanta, so it scales along.
+
+class SchedulingPolicy {
+  public:
+    SchedulingPolicy(int ticks) { quantum = ticks; }
+    virtual ~SchedulingPolicy() {}
+    virtual const char *getName() = 0;	// for debugging
+
+    int getQuantum() { return quantum; }
+    void setQuantum(int ticks) { quantum = ticks; }
+
+    virtual void Add(Thread *thread) = 0;
+    				// A thread is ready to run
+    virtual Thread *Remove() = 0;
+    				// Choose the next thread to run, take it
+				// off the ready list, and return it; or
+				// return NULL if there is none
+    virtual void Charge(Thread *thread, int ticks)
+    		{ thread->quantumUsed += ticks; }
+    				// A thread has run for some time
+    virtual bool ShouldPreempt(Thread *thread) { return TRUE; }
+    				// Should the running thread yield, at a
+				// timer interrupt?
+    virtual void Print() = 0;	// Print the ready threads
+
+  protected:
+    int quantum;		// the time slice, in ticks
+};
+
+// Round robin: threads run in the order they became ready, and the
+// running thread yields at every timer interrupt.  The quantum is
+// TimerTicks.
+
+class FifoPolicy : public SchedulingPolicy {
+  public:
+    FifoPolicy() : SchedulingPolicy(TimerTicks)
+    		{ readyList = new List<Thread *>; }
+    ~FifoPolicy() { delete readyList; }
+    const char *getName() { return "fifo"; }
+
+    void Add(Thread *thread) { readyList->Append(thread); }
+    Thread *Remove();
+    void Print() { readyList->Apply(ThreadPrint); }
+
+  private:
+    List<Thread *> *readyList;
+};
+
+// Multilevel feedback queues: a thread starts in the top queue, and
+// moves down a level each time it uses up the time slice of its level,
+// which is the quantum at the top, and doubles from one level to the
+// next.  Threads that block before their time slice is up (waiting for
+// the console, say) stay near the top, and run first; compute-bound
+// threads sink, and run in longer slices.  Every so often, every thread
+// that has been waiting is moved back to the top, so that none of them
+// starves.  The quantum is TimerTicks / 2, so that the threads at the
+// top get a quick turn; the slices below are TimerTicks and twice that.
+
+const int NumFeedbackLevels = 3;
+
+class FeedbackPolicy : public SchedulingPolicy {
+  public:
+    FeedbackPolicy();
+    ~FeedbackPolicy();
+    const char *getName() { return "mlfq"; }
+
+    void Add(Thread *thread);
+    Thread *Remove();
+    bool ShouldPreempt(Thread *thread);
+    void Print();
+
+  private:
+    List<Thread *> *queues[NumFeedbackLevels];	// ready threads, by
+    						// level; 0 runs first
+    int lastBoost;		// when everybody last moved to the top
+
+    int Quantum(int level);	// the time slice of a level
+    void Boost();		// Move every ready thread to the top
+};
+
+// Strict priority: the ready thread with the highest priority runs; it
+// is preempted by a ready thread of at least the same priority.  The
+// priority of a thread that is waiting goes up with time, so that low
+// priority threads do not starve.  The quantum is TimerTicks.
+
+class PriorityPolicy : public SchedulingPolicy {
+  public:
+    PriorityPolicy() : SchedulingPolicy(TimerTicks)
+    		{ readyList = new List<Thread *>; }
+    ~PriorityPolicy() { delete readyList; }
+    const char *getName() { return "priority"; }
+
+    void Add(Thread *thread) { readyList->Append(thread); }
+    Thread *Remove();
+    bool ShouldPreempt(Thread *thread);
+    void Print() { readyList->Apply(ThreadPrint); }
+
+  private:
+    List<Thread *> *readyList;
+
+    int Effective(Thread *thread);	// priority, plus aging
+    Thread *Best();			// highest effective priority
+};
+
+// Lottery: every thread holds priority + 1 tickets, and the next thread
+// to run is the holder of a ticket drawn at random.  The quantum is
+// TimerTicks / 2: the more drawings, the closer the shares come to the
+// ticket counts.
+
+class LotteryPolicy : public SchedulingPolicy {
+  public:
+    LotteryPolicy() : SchedulingPolicy(TimerTicks / 2)
+    		{ readyList = new List<Thread *>; }
+    ~LotteryPolicy() { delete readyList; }
+    const char *getName() { return "lottery"; }
+
+    void Add(Thread *thread) { readyList->Append(thread); }
+    Thread *Remove();
+    void Print() { readyList->Apply(ThreadPrint); }
+
+  private:
+    List<Thread *> *readyList;
+};
+
+// Stride: the same shares as lottery, without the randomness.  Each
+// thread's "pass" advances as it runs, more slowly the more tickets
+// it has, and the thread with the smallest pass runs next.  The shares
+// are exact, so the quantum can be longer, 2 * TimerTicks, for fewer
+// context switches.
+
+class StridePolicy : public SchedulingPolicy {
+  public:
+    StridePolicy() : SchedulingPolicy(2 * TimerTicks)
+    		{ readyList = new List<Thread *>; virtualTime = 0; }
+    ~StridePolicy() { delete readyList; }
+    const char *getName() { return "stride"; }
+
+    void Add(Thread *thread);
+    Thread *Remove();
+    void Charge(Thread *thread, int ticks);
+    void Print() { readyList->Apply(ThreadPrint); }
+
+  private:
+    List<Thread *> *readyList;
+    int virtualTime;		// pass of the thread that ran last
+};
+
+// The following class defines the scheduler/dispatcher abstraction --
+// the data structures and operations needed to keep track of which
 // thread is running, and which threads are ready but not running.
 
 class Scheduler {
   public:
-    Scheduler();		// Initialize list of ready threads 
+    Scheduler(SchedulingPolicy *schedPolicy);
+    				// Initialize list of ready threads;
+				// the policy is deleted along with us
     ~Scheduler();		// De-allocate ready list
 
-    void ReadyToRun(Thread* thread);	
+    void ReadyToRun(Thread* thread);
     				// Thread can be dispatched.
-    Thread* FindNextToRun();	// Dequeue first thread on the ready 
-				// list, if any, and return thread.
+    Thread* FindNextToRun();	// Dequeue the thread the policy chooses
+				// from the ready list, if any, and
+				// return thread.
     void Run(Thread* nextThread, bool finishing);
     				// Cause nextThread to start running
+    bool ShouldPreempt();	// Should the current thread yield, at a
+    				// timer interrupt?
+    int NumReady() { return numReady; }
+    				// How many threads are ready to run?
+    int getQuantum() { return policy->getQuantum(); }
+    void setQuantum(int ticks) { policy->setQuantum(ticks); }
+    				// The policy's time slice
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
     void Print();		// Print contents of ready list
-    
-    // SelfTest for scheduler is implemented in class Thread
-    
+
+    void SelfTest();		// Run threads of different priorities
+    				// under each policy, and print what
+				// share of the CPU they got
+
   private:
-    List<Thread *> *readyList;  // queue of threads that are ready to run,
-				// but not running
+    SchedulingPolicy *policy;	// keeps the threads that are ready to
+    				// run, but not running
+    int numReady;		// how many threads it has
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
+
+    void Account(Thread *thread);	// Charge the running thread for
+    					// the time since it was last charged
 };
 
 #endif // SCHEDULER_H
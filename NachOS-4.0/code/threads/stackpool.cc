@@ -0,0 +1,85 @@
+// stackpool.cc
+//	Routines to recycle the execution stacks of threads.
+//
+//	Nothing here makes simulated time advance, so no context switch
+//	can catch the pool half way through a change; it needs no lock.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "stackpool.h"
+#include "sysdep.h"
+
+//----------------------------------------------------------------------
+// StackPool::StackPool
+// 	Initialize an empty pool of stacks.
+//
+//	"words" -- the size of every stack, in words
+//	"maxStacks" -- how many unused stacks to keep, at most; 0 means
+//		every stack goes back to the host when its thread is done
+//----------------------------------------------------------------------
+
+StackPool::StackPool(int words, int maxStacks)
+{
+    stackWords = words;
+    maxFree = maxStacks;
+    numFree = 0;
+    freeStacks = new int *[maxStacks + 1];	// never allocate 0
+}
+
+//----------------------------------------------------------------------
+// StackPool::~StackPool
+// 	Give the stacks in the pool back to the host, and de-allocate the
+//	pool.
+//----------------------------------------------------------------------
+
+StackPool::~StackPool()
+{
+    for (int i = 0; i < numFree; i++) {
+	DeallocBoundedArray((char *) freeStacks[i], stackWords * sizeof(int));
+    }
+    delete [] freeStacks;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Allocate
+// 	Return a stack for a new thread: one that was used before, if the
+//	pool has any, otherwise a new one.  Either way, its boundary pages
+//	are unmapped.
+//----------------------------------------------------------------------
+
+int *
+StackPool::Allocate()
+{
+    int *stack;
+
+    if (numFree > 0) {
+	stack = freeStacks[--numFree];
+    } else {
+	DEBUG(dbgThread, "Allocating a new stack");
+	stack = (int *) AllocBoundedArray(stackWords * sizeof(int));
+    }
+    return stack;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Free
+// 	Take back the stack of a thread that is being destroyed (which
+//	had better not be the current thread).  Keep it, if there is 
+//	room in the pool.
+//
+//	"stack" -- the stack, from Allocate
+//----------------------------------------------------------------------
+
+void
+StackPool::Free(int *stack)
+{
+    if (numFree < maxFree) {
+	freeStacks[numFree++] = stack;
+    } else {
+	DeallocBoundedArray((char *) stack, stackWords * sizeof(int));
+    }
+}
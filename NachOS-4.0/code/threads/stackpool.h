@@ -0,0 +1,50 @@
+// stackpool.h
+//	Data structures to recycle the execution stacks of threads.
+//
+//	Every thread but the main one runs on a stack of its own, with
+//	an unmapped page at each end, to catch overflows (see
+//	AllocBoundedArray in sysdep.cc).  Setting that up, and tearing it
+//	down, takes several calls to the host OS.  So when a thread is
+//	destroyed, its stack is kept in a pool, still guarded, and handed
+//	to the next thread that is forked.  The pool only holds so many;
+//	beyond that, stacks are given back to the host.
+//
+//	All stacks have the same size, chosen when Nachos starts up (see
+//	the -stack and -stackpool flags in kernel.cc).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef STACKPOOL_H
+#define STACKPOOL_H
+
+#include "copyright.h"
+
+const int StackPoolSize = 16;		// stacks kept for reuse, by default
+
+// The following class defines the pool of stacks.  There is only one,
+// kernel->stackPool.
+
+class StackPool {
+  public:
+    StackPool(int words, int maxStacks);
+    				// Initialize an empty pool, of stacks of
+				// "words" words, keeping at most
+				// "maxStacks" of them
+    ~StackPool();		// Give every stack in the pool back
+
+    int *Allocate();		// Return a stack, from the pool if
+    				// possible
+    void Free(int *stack);	// A thread is done with its stack
+    int StackWords() { return stackWords; }
+    				// The size of every stack, in words
+
+  private:
+    int stackWords;		// the size of a stack
+    int maxFree;		// how many stacks the pool can hold
+    int numFree;		// how many it holds now
+    int **freeStacks;		// the stacks it holds
+};
+
+#endif // STACKPOOL_H
@@ -24,7 +24,7 @@
 //	that your thread stacks are too small.)
 //	
 //	One thing to try if you find yourself with seg faults is to
-//	increase the size of thread stack -- ThreadStackSize.
+//	increase the size of thread stack -- StackSize, or the -stack flag.
 //
 //  	In this interface, forking a thread takes two steps.
 //	We must first allocate a data structure for it: "t = new Thread".
@@ -54,10 +54,15 @@
 #define MachineStateSize 75 
 
 
-// Size of the thread's private execution stack.
+// Size of the thread's private execution stack, unless the -stack flag
+// says otherwise.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024);	// in words
 
+// Thread priorities, for the scheduling policies that use them 
+// (see scheduler.h); higher is better.  New threads get the lowest.
+const int MaxPriority = 9;
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
@@ -101,6 +106,9 @@ class Thread {
     
     void CheckOverflow();   	// Check if thread stack has overflowed
     void setStatus(ThreadStatus st) { status = st; }
+    void setPriority(int p) { priority = (p < 0) ? 0 :
+    				(p > MaxPriority) ? MaxPriority : p; }
+    int getPriority() { return (priority); }
     char* getName() { return (name); }
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
@@ -111,8 +119,10 @@ class Thread {
     int *stack; 	 	// Bottom of the stack 
 				// NULL if this is the main thread
 				// (If NULL, don't deallocate stack)
+    int stackSize;		// Size of the stack, in words
     ThreadStatus status;	// ready, running or blocked
     char* name;
+    int priority;		// 0 to MaxPriority
 
     void StackAllocate(VoidFunctionPtr func, void *arg);
     				// Allocate a stack for thread.
@@ -129,6 +139,20 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+    bool killed;			// Another thread exited the program;
+    					// exit as soon as it is safe to
+
+// Scheduling information, kept up to date by the Scheduler, for its
+// policy to go by.  Times are in ticks of stats->totalTicks.
+
+    int runTicks;			// total time spent running
+    int waitTicks;			// total time spent ready to run
+    int runSince;			// when the thread was last charged
+    					// for running
+    int readySince;			// when it last became ready
+    int quantumUsed;			// how much of its time slice is gone
+    int level;				// feedback queue it is in
+    int pass;				// virtual time, for stride scheduling
 };
 
 // external function, dummy routine whose sole job is to call Thread::Print
@@ -20,6 +20,8 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "frametable.h"
+#include "swap.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -60,44 +62,57 @@ SwapHeader (NoffHeader *noffH)
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Set up the translation from program memory to physical 
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	The page table is set up by Load, once we know how big the
+//	program is; no physical memory is used until pages are touched.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace()
 {
-    pageTable = new TranslationEntry[NumPhysPages];
-    for (int i = 0; i < NumPhysPages; i++) {
-	pageTable[i].virtualPage = i;	// for now, virt page # = phys page #
-	pageTable[i].physicalPage = i;
-	pageTable[i].valid = TRUE;
-	pageTable[i].use = FALSE;
-	pageTable[i].dirty = FALSE;
-	pageTable[i].readOnly = FALSE;  
-    }
-    
-    // zero out the entire address space
-    bzero(kernel->machine->mainMemory, MemorySize);
+    pageTable = NULL;
+    numPages = 0;
+    executable = NULL;
+    image = -1;
+    swapSlot = NULL;
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, giving back its physical frames
+//	and swap slots.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+    kernel->frameTable->Acquire();
+    for (unsigned int i = 0; i < numPages; i++) {
+	if (pageTable[i].valid && pageTable[i].readOnly) {
+	    kernel->frameTable->Unshare(pageTable[i].physicalPage, this);
+	} else if (pageTable[i].valid) {
+	    kernel->frameTable->Free(pageTable[i].physicalPage);
+	}
+	if (swapSlot[i] != -1) {
+	    kernel->swapSpace->Free(swapSlot[i]);
+	}
+    }
+    kernel->frameTable->Release();
+
+    if (kernel->machine->pageTable == pageTable) {
+	kernel->machine->pageTable = NULL;	// see RestoreState
+    }
+    delete [] pageTable;
+    delete [] swapSlot;
+    delete executable;
 }
 
 
 //----------------------------------------------------------------------
 // AddrSpace::Load
-// 	Load a user program into memory from a file.
+// 	Prepare to run a user program from a file.  Only the header is
+//	read here: each page is loaded from the file by PageFault the
+//	first time it is touched, so the file is kept open for as long
+//	as the address space exists.
 //
-//	Assumes that the page table has been initialized, and that
-//	the object code file is in NOFF format.
+//	Assumes that the object code file is in NOFF format.
 //
 //	"fileName" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
@@ -105,14 +120,15 @@ AddrSpace::~AddrSpace()
 bool 
 AddrSpace::Load(char *fileName) 
 {
-    OpenFile *executable = kernel->fileSystem->Open(fileName);
-    NoffHeader noffH;
     unsigned int size;
 
+    executable = kernel->fileSystem->Open(fileName);
+
     if (executable == NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
 	return FALSE;
     }
+    image = executable->Identity();
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -123,54 +139,271 @@ AddrSpace::Load(char *fileName)
 #ifdef RDATA
 // how big is address space?
     size = noffH.code.size + noffH.readonlyData.size + noffH.initData.size +
-           noffH.uninitData.size + UserStackSize;	
-                                                // we need to increase the size
-						// to leave room for the stack
+           noffH.uninitData.size;
 #else
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
-			+ UserStackSize;	// we need to increase the size
-						// to leave room for the stack
+    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size;
 #endif
-    numPages = divRoundUp(size, PageSize);
+    numPages = divRoundUp(size, PageSize)	// we need to increase the size
+    		+ MaxUserThreads * divRoundUp(UserStackSize, PageSize);
+						// to leave room for the stacks
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages);		// check we're not trying
-						// to run anything too big --
-						// at least until we have
-						// virtual memory
-
     DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
 
-// then, copy in the code and data segments into memory
-// Note: this code assumes that virtual address = physical address
-    if (noffH.code.size > 0) {
-        DEBUG(dbgAddr, "Initializing code segment.");
-	DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.code.virtualAddr]), 
-			noffH.code.size, noffH.code.inFileAddr);
+// every page starts out on the executable (or all zeroes), not in memory
+    pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    for (unsigned int i = 0; i < numPages; i++) {
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = -1;
+	pageTable[i].valid = FALSE;
+	pageTable[i].use = FALSE;
+	pageTable[i].dirty = FALSE;
+	pageTable[i].readOnly = FALSE;
+	swapSlot[i] = -1;
     }
-    if (noffH.initData.size > 0) {
-        DEBUG(dbgAddr, "Initializing data segment.");
-	DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
-			noffH.initData.size, noffH.initData.inFileAddr);
+
+    return TRUE;			// success
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageFault
+// 	Bring the page containing "virtAddr" into physical memory, after 
+//	the machine raised a PageFaultException on it.
+//
+//	A page that was pushed out to swap after being modified gets a
+//	frame of its own, filled from swap.  A page that comes (at least
+//	partly) from the executable is mapped read-only to the shared
+//	frame holding that page of the program, loading the frame first
+//	if no other address space has; CopyOnWrite un-shares it if the
+//	program writes to it.  The rest (uninitialized data, and stack)
+//	get a frame of their own, zero-filled.  Getting a frame may
+//	evict some other page.
+//
+//	Returns FALSE if the address is outside the address space.
+//
+//	"virtAddr" -- the address that caused the fault
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::PageFault(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    bool shared;
+    int frame;
+
+    if (vpn >= numPages) {
+	return FALSE;
+    }
+
+    kernel->frameTable->Acquire();
+    if (!pageTable[vpn].valid) {	// not brought in while we waited
+	kernel->stats->numPageFaults++;
+	shared = (swapSlot[vpn] == -1 && FromExecutable(vpn));
+	frame = -1;
+	if (shared) {
+	    frame = kernel->frameTable->FindShared(image, vpn);
+	}
+	if (frame != -1) {
+	    DEBUG(dbgAddr, "Page fault on virtual page " << vpn << ", sharing frame " << frame);
+	    kernel->frameTable->Share(frame, this);
+	} else {
+	    frame = kernel->frameTable->Allocate(this, vpn,
+						shared ? image : -1);
+	    DEBUG(dbgAddr, "Page fault on virtual page " << vpn << ", using frame " << frame);
+	    LoadPage(vpn, &(kernel->machine->mainMemory[frame * PageSize]));
+	    kernel->machine->InvalidateDecodeCache(frame);
+	}
+
+	pageTable[vpn].physicalPage = frame;
+	pageTable[vpn].use = FALSE;
+	pageTable[vpn].dirty = FALSE;
+	pageTable[vpn].readOnly = shared;
+	pageTable[vpn].valid = TRUE;
     }
+    kernel->frameTable->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	The program wrote to a page that it shares with other address
+//	spaces (the machine raised a ReadOnlyException), so give it a
+//	frame of its own, with a copy of the shared page in it.
+//
+//	Returns FALSE if the page is not shared, i.e., the write really
+//	was an error.
+//
+//	"virtAddr" -- the address that caused the exception
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    TranslationEntry *entry;
+    char *dest;
+    int frame;
 
+    if (vpn >= numPages) {
+	return FALSE;
+    }
+
+    kernel->frameTable->Acquire();
+    entry = &pageTable[vpn];
+    if (!entry->readOnly) {		// already copied while we waited
+	kernel->frameTable->Release();
+	return TRUE;
+    }
+
+    frame = kernel->frameTable->Allocate(this, vpn);
+    dest = &(kernel->machine->mainMemory[frame * PageSize]);
+    DEBUG(dbgAddr, "Copy on write of virtual page " << vpn << " to frame " << frame);
+    if (entry->valid) {
+	bcopy(&(kernel->machine->mainMemory[entry->physicalPage * PageSize]),
+			dest, PageSize);
+	kernel->frameTable->Unshare(entry->physicalPage, this);
+    } else {			// the shared frame was just evicted
+	LoadPage(vpn, dest);
+    }
+    kernel->machine->InvalidateDecodeCache(frame);
+
+    entry->physicalPage = frame;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->readOnly = FALSE;
+    entry->valid = TRUE;
+    InvalidateTranslation(vpn);
+    kernel->frameTable->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FromExecutable
+// 	Return TRUE if any part of a virtual page is loaded from the
+//	executable (code, read-only data, or initialized data).
+//
+//	"virtualPage" -- the page
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::FromExecutable(int virtualPage)
+{
+    Segment *segments[3];
+    int numSegments = 0;
+    int pageStart = virtualPage * PageSize;
+
+    segments[numSegments++] = &noffH.code;
 #ifdef RDATA
-    if (noffH.readonlyData.size > 0) {
-        DEBUG(dbgAddr, "Initializing read only data segment.");
-	DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-        executable->ReadAt(
-		&(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
-			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+    segments[numSegments++] = &noffH.readonlyData;
+#endif
+    segments[numSegments++] = &noffH.initData;
+
+    for (int i = 0; i < numSegments; i++) {
+	if (segments[i]->size > 0 
+		&& segments[i]->virtualAddr < pageStart + PageSize
+		&& segments[i]->virtualAddr + segments[i]->size > pageStart) {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill in the contents of a virtual page, from swap or from the 
+//	executable.
+//
+//	"virtualPage" -- the page to load
+//	"dest" -- where it goes in physical memory
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPage(int virtualPage, char *dest)
+{
+    if (swapSlot[virtualPage] != -1) {
+	kernel->swapSpace->ReadPage(swapSlot[virtualPage], dest);
+	return;
     }
+
+    bzero(dest, PageSize);		// uninitialized data and stack
+    LoadSegment(&noffH.code, virtualPage, dest);
+#ifdef RDATA
+    LoadSegment(&noffH.readonlyData, virtualPage, dest);
 #endif
+    LoadSegment(&noffH.initData, virtualPage, dest);
+}
 
-    delete executable;			// close file
-    return TRUE;			// success
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Read the part of an executable segment that falls on a virtual
+//	page (if any) into the page's frame.
+//
+//	"segment" -- which segment of the executable
+//	"virtualPage" -- the page being loaded
+//	"dest" -- where the page goes in physical memory
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadSegment(Segment *segment, int virtualPage, char *dest)
+{
+    int pageStart = virtualPage * PageSize;
+    int start = max(segment->virtualAddr, pageStart);
+    int end = min(segment->virtualAddr + segment->size, pageStart + PageSize);
+
+    if (segment->size > 0 && start < end) {
+	DEBUG(dbgAddr, "Loading " << end - start << " bytes at " << start);
+	executable->ReadAt(dest + (start - pageStart), end - start,
+			segment->inFileAddr + (start - segment->virtualAddr));
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Evict
+// 	Push a page out of physical memory, because the frame table
+//	wants its frame back.  If the page was modified since it was
+//	loaded, save it to swap first; otherwise, the copy we loaded it
+//	from (swap, or the executable) is still good.
+//
+//	The frame table is locked by the caller.
+//
+//	"virtualPage" -- the page to push out
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Evict(int virtualPage)
+{
+    TranslationEntry *entry = &pageTable[virtualPage];
+
+    ASSERT(entry->valid);
+    if (entry->dirty) {
+	if (swapSlot[virtualPage] == -1) {
+	    swapSlot[virtualPage] = kernel->swapSpace->Allocate();
+	    ASSERT(swapSlot[virtualPage] != -1);	// out of swap space
+	}
+	kernel->swapSpace->WritePage(swapSlot[virtualPage],
+		&(kernel->machine->mainMemory[entry->physicalPage * PageSize]));
+    }
+    entry->valid = FALSE;
+    InvalidateTranslation(virtualPage);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InvalidateTranslation
+// 	The page table entry for a virtual page changed (it was evicted,
+//	or its use bit was cleared).  If this address space is the one 
+//	the machine is running, make it forget its cached translation.
+//
+//	"virtualPage" -- the page whose entry changed
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InvalidateTranslation(int virtualPage)
+{
+    if (kernel->machine->pageTable == pageTable) {
+	kernel->machine->InvalidateTranslation(virtualPage);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -180,10 +413,12 @@ AddrSpace::Load(char *fileName)
 //      The program is assumed to have already been loaded into
 //      the address space
 //
+//	"argc", "argv" -- the arguments for the program's main(), 
+//		in kernel memory; argc is 0 if there are none
 //----------------------------------------------------------------------
 
 void 
-AddrSpace::Execute() 
+AddrSpace::Execute(int argc, char **argv) 
 {
 
     kernel->currentThread->space = this;
@@ -191,6 +426,10 @@ AddrSpace::Execute()
     this->InitRegisters();		// set the initial register values
     this->RestoreState();		// load page table register
 
+    if (argc > 0) {
+	this->PushArguments(argc, argv);
+    }
+
     kernel->machine->Run();		// jump to the user progam
 
     ASSERTNOTREACHED();			// machine->Run never returns;
@@ -229,10 +468,99 @@ AddrSpace::InitRegisters()
     machine->WriteRegister(NextPCReg, 4);
 
    // Set the stack register to the end of the address space, where we
-   // allocated the stack; but subtract off a bit, to make sure we don't
-   // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG(dbgAddr, "Initializing stack pointer: " << numPages * PageSize - 16);
+   // allocated the first thread's stack
+    machine->WriteRegister(StackReg, StackTop(0));
+    DEBUG(dbgAddr, "Initializing stack pointer: " << StackTop(0));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StackTop
+// 	Return the initial stack pointer of one of the stacks: its end,
+//	but subtract off a bit, to make sure we don't accidentally
+//	reference off the end!
+//
+//	"stack" -- which stack; 0 is the first thread's, at the end of 
+//		the address space
+//----------------------------------------------------------------------
+
+int
+AddrSpace::StackTop(int stack)
+{
+    ASSERT(stack >= 0 && stack < MaxUserThreads);
+    return (numPages - stack * divRoundUp(UserStackSize, PageSize))
+    		* PageSize - 16;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ExecuteThread
+// 	Run a procedure of the program, in another thread of it, using
+//	the current (kernel) thread.
+//
+//	"stack" -- which of the address space's stacks the thread uses
+//	"func" -- the procedure's address
+//	"returnAddr" -- where the procedure returns to, when it is done
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ExecuteThread(int stack, int func, int returnAddr)
+{
+    Machine *machine = kernel->machine;
+
+    kernel->currentThread->space = this;
+
+    this->InitRegisters();		// then start at "func" instead,
+    machine->WriteRegister(PCReg, func);	// on our own stack
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(StackReg, StackTop(stack));
+    machine->WriteRegister(RetAddrReg, returnAddr);
+    DEBUG(dbgAddr, "Starting thread at " << func << ", stack pointer: "
+    			<< StackTop(stack));
+    this->RestoreState();		// load page table register
+
+    machine->Run();			// jump to the user progam
+
+    ASSERTNOTREACHED();			// the thread exits by doing the
+    					// syscall "ThreadExit"
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PushArguments
+// 	Copy the program's arguments to the top of its stack: first the
+//	strings, then the array of pointers to them (followed by a NULL
+//	pointer, as in UNIX), then the four words of argument space the
+//	MIPS calling convention asks for.  Start.S passes r4 and r5
+//	straight through to main(), so that is where argc and argv go.
+//
+//	Must be called after InitRegisters and RestoreState, since the
+//	strings are copied with the machine's current page table.
+//
+//	"argc", "argv" -- the arguments, in kernel memory
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PushArguments(int argc, char **argv)
+{
+    Machine *machine = kernel->machine;
+    int sp = machine->ReadRegister(StackReg);
+    int *userArgv = new int[argc + 1];
+    int i;
+
+    for (i = argc - 1; i >= 0; i--) {
+	sp -= strlen(argv[i]) + 1;
+	machine->CopyOut(sp, argv[i], strlen(argv[i]) + 1);
+	userArgv[i] = WordToMachine(sp);
+    }
+    userArgv[argc] = 0;
+
+    sp &= ~3;				// word-align the pointer array
+    sp -= (argc + 1) * sizeof(int);
+    machine->CopyOut(sp, (char *) userArgv, (argc + 1) * sizeof(int));
+    delete [] userArgv;
+
+    machine->WriteRegister(4, argc);
+    machine->WriteRegister(5, sp);
+    machine->WriteRegister(StackReg, sp - 16);	// argument space
+    DEBUG(dbgAddr, "Pushed " << argc << " arguments, stack pointer: " << sp - 16);
 }
 
 //----------------------------------------------------------------------
@@ -251,13 +579,20 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//      make it forget translations cached from the previous one.
+//	When switching between threads of the same program, the cached
+//	translations are still good.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
+    if (kernel->machine->pageTable == pageTable) {
+	return;
+    }
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->FlushTranslations();
 }
 
 
@@ -283,6 +618,10 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
 
     pte = &pageTable[vpn];
 
+    if(!pte->valid) {
+        return PageFaultException;
+    }
+
     if(isReadWrite && pte->readOnly) {
         return ReadOnlyException;
     }
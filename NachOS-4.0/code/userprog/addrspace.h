@@ -2,9 +2,20 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
-//	The user level CPU state is saved and restored in the thread
-//	executing the user program (see thread.h).
+//	Address spaces are demand paged: a page is only brought into a
+//	physical frame (from the executable, or from swap) when the
+//	program first touches it, and it may be pushed out again to make
+//	room for other pages (see frametable.h).  Pages that come from
+//	the executable are shared, read-only, by all address spaces
+//	running the same program, until one of them writes to the page
+//	and gets a private copy ("copy-on-write").  The user level CPU 
+//	state is saved and restored in the thread executing the user
+//	program (see thread.h).
+//
+//	A program may run several threads (see ptable.h), so the top of
+//	the address space holds MaxUserThreads stacks, one above the
+//	other; the first thread's is the highest.  Like everything else,
+//	a stack takes no memory until it is touched.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -15,8 +26,11 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "noff.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define MaxUserThreads		8	// threads per program, each with
+					// a stack of UserStackSize
 
 class AddrSpace {
   public:
@@ -27,9 +41,14 @@ class AddrSpace {
                                         // a file
 					// return false if not found
 
-    void Execute();             	// Run a program
-					// assumes the program has already
-                                        // been loaded
+    void Execute(int argc = 0, char **argv = NULL);
+    					// Run a program, passing argc and
+					// argv to its main(); assumes the
+					// program has already been loaded
+    void ExecuteThread(int stack, int func, int returnAddr);
+    					// Run a procedure of the program
+					// on one of its stacks, returning
+					// to "returnAddr"
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
@@ -39,14 +58,51 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    bool PageFault(int virtAddr);	// Bring in the page containing
+					// virtAddr; return FALSE if it is
+					// not part of the address space
+    bool CopyOnWrite(int virtAddr);	// Give the page containing
+					// virtAddr a private, writable copy
+					// of its shared frame
+    void Evict(int virtualPage);	// Push a page out of its frame,
+					// saving it to swap if needed
+
+    TranslationEntry *PageTableEntry(int virtualPage)
+			{ return &pageTable[virtualPage]; }
+    void InvalidateTranslation(int virtualPage);
+    					// The page table entry changed;
+					// tell the machine if it cares
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
 
+    OpenFile *executable;		// where code and data pages that
+					// were never loaded come from
+    int image;				// the identity of the executable's
+					// file, which finds its shared frames
+    NoffHeader noffH;			// the layout of the executable
+    int *swapSlot;			// for each virtual page, the swap
+					// slot holding it, or -1
+
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
+    int StackTop(int stack);		// The initial stack pointer of
+    					// one of the stacks
+    void PushArguments(int argc, char **argv);
+    					// Copy the arguments onto the user
+					// stack, and point main() at them
+
+    bool FromExecutable(int virtualPage);
+    					// Does any of the page come from 
+					// the executable?
+    void LoadPage(int virtualPage, char *dest);
+    					// Fill a frame with a virtual page
+    void LoadSegment(Segment *segment, int virtualPage, char *dest);
+    					// Copy the part of a segment that
+					// falls on a virtual page
 
 };
 
@@ -46,8 +46,32 @@
 //
 //	"which" is the kind of exception.  The list of possible exceptions 
 //	is in machine.h.
+//
+//	A program that causes an exception the kernel cannot fix up (an
+//	address error, an illegal instruction, an unknown system call...)
+//	exits with status -1, along with all its threads.
+//
+//	NoException means that the thread was switched out by a timer
+//	interrupt, and is about to go back to user code.  Like a system
+//	call, that is a point where it holds no locks, so a thread that
+//	another thread of its process killed (see ProcessTable::Exit)
+//	exits there.
 //----------------------------------------------------------------------
 
+/** Size of the kernel bounce buffer used by the Read and Write system calls.
+ *  Data is moved between user space and the file through it in chunks of
+ *  at most this many bytes, so the kernel never allocates a buffer as big
+ *  as the user's.
+ */
+#define IO_BUFFER_SIZE (4 * PageSize)
+
+/** Limits on the arguments of the ExecV system call.
+ *  The arguments are copied onto the new program's stack, so together
+ *  they must leave most of the stack for the program itself.
+ */
+#define MAX_ARGS 16
+#define MAX_ARGS_SIZE (UserStackSize / 4)
+
 char* User2System(int addr);
 void System2User(int addr, char* buffer);
 
@@ -67,6 +91,16 @@ void SysReadHandler();
 void SysWriteHandler();
 void SysSeekHandler();
 void SysRemoveHandler();
+void SysExitHandler();
+void SysExecHandler();
+void SysExecVHandler();
+void SysJoinHandler();
+void SysSleepHandler();
+void SysSetPriorityHandler();
+void SysThreadForkHandler();
+void SysThreadYieldHandler();
+void SysThreadJoinHandler();
+void SysThreadExitHandler();
 
 void
 ExceptionHandler(ExceptionType which)
@@ -79,9 +113,19 @@ ExceptionHandler(ExceptionType which)
     case NoException:
         kernel->interrupt->setStatus(SystemMode);
         DEBUG(dbgSys, "Switch to system mode\n");
+        if (kernel->currentThread->killed)
+            SysThreadExit(-1);          // another thread exited the process
         return;
     case PageFaultException:
+        if (kernel->currentThread->space->PageFault(kernel->machine->ReadRegister(BadVAddrReg)))
+            return;     // the page is in memory now; retry the access
+        cerr << "An error occurs. Error Code: " << which << "\n";
+        break;
     case ReadOnlyException:
+        if (kernel->currentThread->space->CopyOnWrite(kernel->machine->ReadRegister(BadVAddrReg)))
+            return;     // the page is private and writable now; retry the write
+        cerr << "An error occurs. Error Code: " << which << "\n";
+        break;
     case BusErrorException:
     case AddressErrorException:
     case OverflowException:
@@ -90,6 +134,9 @@ ExceptionHandler(ExceptionType which)
         cerr << "An error occurs. Error Code: " << which << "\n";
         break;
     case SyscallException:
+        if (kernel->currentThread->killed)
+            return SysThreadExit(-1);   // another thread exited the process
+
         switch (type) {
         case SC_Halt:
             return SysHaltHandler();
@@ -123,6 +170,26 @@ ExceptionHandler(ExceptionType which)
             return SysSeekHandler();
         case SC_Remove:
             return SysRemoveHandler();
+        case SC_Exit:
+            return SysExitHandler();
+        case SC_Exec:
+            return SysExecHandler();
+        case SC_ExecV:
+            return SysExecVHandler();
+        case SC_Join:
+            return SysJoinHandler();
+        case SC_Sleep:
+            return SysSleepHandler();
+        case SC_SetPriority:
+            return SysSetPriorityHandler();
+        case SC_ThreadFork:
+            return SysThreadForkHandler();
+        case SC_ThreadYield:
+            return SysThreadYieldHandler();
+        case SC_ThreadJoin:
+            return SysThreadJoinHandler();
+        case SC_ThreadExit:
+            return SysThreadExitHandler();
         default:
             cerr << "Unexpected system call " << type << "\n";
             break;
@@ -133,51 +200,44 @@ ExceptionHandler(ExceptionType which)
         break;
     }
 
-    SysHalt();
+    /* the program did something wrong: it exits, the others keep running */
+    SysExit(-1);
     ASSERTNOTREACHED();
 }
 
 /** Get string from user space.
  *  @param addr The address of the string in user space.
  *  @return string but in kernel space.
- *  @idea count the length of the string through kernel->machine->ReadMem()
- *        then allocate dynamic memory for the string
- *        then read the string from user space to kernel space
- *        then return it
+ *  @idea copy the string a page at a time with kernel->machine->CopyInString()
+ *        into a kernel buffer, doubling the buffer while the string does
+ *        not fit, so the string is only walked once
  */
 char* User2System(int addr)
 {
-    char* buffer = NULL;
+    int size = PageSize;
     int length = 0;
-    int c;
+    char* buffer = new char[size + 1];
 
     while (true)
     {
-        if (!kernel->machine->ReadMem(addr + length, 1, &c))
-            return NULL;
-
-        if (c == '\0')
-            break;
-
-        length++;
-    }
-
-    buffer = new char[length + 1];
-
-    if (buffer == NULL)
-        return NULL;
+        int copied = kernel->machine->CopyInString(addr + length, buffer + length, size - length);
 
-    buffer[length] = '\0';
-
-    for (int i = 0; i < length; i++)
-    {
-        if (!kernel->machine->ReadMem(addr + i, 1, &c))
+        if (copied < 0)
         {
             delete[] buffer;
             return NULL;
         }
 
-        buffer[i] = (char)c;
+        length += copied;
+
+        if (length < size)
+            break;
+
+        char* bigger = new char[2 * size + 1];
+        memcpy(bigger, buffer, length);
+        delete[] buffer;
+        buffer = bigger;
+        size *= 2;
     }
 
     return buffer;
@@ -187,17 +247,14 @@ char* User2System(int addr)
  *  @param addr The address of the string in user space.
  *  @param buffer The string to be put in user space.
  *  @idea if buffer is NULL, do nothing (the result string in user space is empty or NULL)
- *        else put the string to user space
+ *        else copy the string and its terminator with kernel->machine->CopyOut()
  */
 void System2User(int addr, char* buffer)
 {
     if (buffer == NULL)
         return;
 
-    int length = strlen(buffer) + 1;
-
-    for (int i = 0; i < length; i++)
-        kernel->machine->WriteMem(addr + i, 1, buffer[i]);
+    kernel->machine->CopyOut(addr, buffer, strlen(buffer) + 1);
 }
 
 /** Increase program counter to next instruction. */
@@ -387,9 +444,11 @@ void SysCloseHandler()
  * @idea get virtual address of buffer from register 4
  *       get length of buffer from register 5
  *       get file id from register 6
- *       read file by using SysReadFile()
- *       put buffer to user space by using System2User()
- *       delete buffer buffer in kernel space
+ *       read at most IO_BUFFER_SIZE bytes at a time into a kernel bounce buffer by using SysRead()
+ *       and copy them to user space by using kernel->machine->CopyOut()
+ *       until length bytes are read, or the file (or the console line) ends
+ *       put the number of bytes read to register 2, or -1 if the buffer could not be written
+ *       (the bytes SysRead consumed by then cannot be given back, so a short count would hide their loss)
  *       increase pc
  */
 void SysReadHandler()
@@ -398,13 +457,31 @@ void SysReadHandler()
     int length = kernel->machine->ReadRegister(5);
     int id = kernel->machine->ReadRegister(6);
 
-    char* buffer = SysRead(length, id);
+    char buffer[IO_BUFFER_SIZE];
+    int total = 0;
 
-    kernel->machine->WriteRegister(2, buffer ? strlen(buffer) : 0);
+    while (total < length)
+    {
+        int chunk = min(length - total, IO_BUFFER_SIZE);
+        int count = SysRead(buffer, chunk, id);
 
-    System2User(addr, buffer);
+        if (count <= 0)
+            break;
 
-    delete[] buffer;
+        if (!kernel->machine->CopyOut(addr + total, buffer, count))
+        {
+            total = -1;
+            break;
+        }
+
+        total += count;
+
+        // end of file, or end of a line typed on the console
+        if (count < chunk || (id == CONSOLE_INPUT && buffer[count - 1] == '\n'))
+            break;
+    }
+
+    kernel->machine->WriteRegister(2, total);
 
     return IncreasePC();
 }
@@ -413,8 +490,10 @@ void SysReadHandler()
  * @idea get virtual address of buffer from register 4
  *       get length of buffer from register 5
  *       get file id from register 6
- *       get string to write from user space by using User2System()
- *       write file by using SysWriteFile()
+ *       copy at most IO_BUFFER_SIZE bytes at a time from user space into a kernel bounce buffer
+ *       by using kernel->machine->CopyIn() and write them by using SysWrite()
+ *       until length bytes are written, or a write comes up short
+ *       put the number of bytes written to register 2
  *       increase pc
  */
 void SysWriteHandler()
@@ -423,12 +502,28 @@ void SysWriteHandler()
     int length = kernel->machine->ReadRegister(5);
     int id = kernel->machine->ReadRegister(6);
 
-    char* buffer = User2System(addr);
-    buffer[length] = '\0';
+    char buffer[IO_BUFFER_SIZE];
+    int total = 0;
 
-    kernel->machine->WriteRegister(2, (int)SysWrite(buffer, id));
+    while (total < length)
+    {
+        int chunk = min(length - total, IO_BUFFER_SIZE);
 
-    delete[] buffer;
+        if (!kernel->machine->CopyIn(addr + total, buffer, chunk))
+            break;
+
+        int count = SysWrite(buffer, chunk, id);
+
+        if (count <= 0)
+            break;
+
+        total += count;
+
+        if (count < chunk)
+            break;
+    }
+
+    kernel->machine->WriteRegister(2, total);
 
     return IncreasePC();
 }
@@ -468,3 +563,202 @@ void SysRemoveHandler()
 
     return IncreasePC();
 }
+
+/** Handle exit system call.
+ * @idea get exit status from register 4
+ *       exit the current process by using SysExit(), which never returns
+ */
+void SysExitHandler()
+{
+    int status = kernel->machine->ReadRegister(4);
+
+    DEBUG(dbgSys, "Exit with status " << status << "\n");
+
+    SysExit(status);
+
+    ASSERTNOTREACHED();
+}
+
+/** Handle exec system call.
+ * @idea get virtual address of file name from register 4
+ *       get file name from user space by using User2System()
+ *       start the program in a new process by using SysExec()
+ *       put the process id to register 2
+ *       delete file name buffer in kernel space
+ *       increase pc
+ */
+void SysExecHandler()
+{
+    int addr = kernel->machine->ReadRegister(4);
+    char* buffer = User2System(addr);
+
+    kernel->machine->WriteRegister(2, (int)SysExec(buffer));
+
+    delete[] buffer;
+
+    return IncreasePC();
+}
+
+/** Handle exec with arguments system call.
+ * @idea get number of arguments from register 4
+ *       get virtual address of the argument array from register 5
+ *       copy each pointer with kernel->machine->CopyIn() and each string with User2System()
+ *       as long as there are at most MAX_ARGS arguments of at most MAX_ARGS_SIZE bytes in all
+ *       start the program in a new process by using SysExecV(), which takes over the arguments
+ *       put the process id (or -1) to register 2
+ *       increase pc
+ */
+void SysExecVHandler()
+{
+    int argc = kernel->machine->ReadRegister(4);
+    int addr = kernel->machine->ReadRegister(5);
+    int result = -1;
+
+    if (argc > 0 && argc <= MAX_ARGS)
+    {
+        char** argv = new char*[argc];
+        int size = 0;
+        int i;
+
+        for (i = 0; i < argc; i++)
+        {
+            int arg;
+
+            if (!kernel->machine->CopyIn(addr + i * 4, (char*)&arg, 4))
+                break;
+
+            argv[i] = User2System(WordToHost(arg));
+
+            if (argv[i] == NULL)
+                break;
+
+            size += strlen(argv[i]) + 1;
+
+            if (size > MAX_ARGS_SIZE)
+            {
+                delete[] argv[i];
+                break;
+            }
+        }
+
+        if (i == argc)
+            result = SysExecV(argc, argv);
+        else
+        {
+            while (--i >= 0)
+                delete[] argv[i];
+            delete[] argv;
+        }
+    }
+
+    kernel->machine->WriteRegister(2, result);
+
+    return IncreasePC();
+}
+
+/** Handle join system call.
+ * @idea get process id from register 4
+ *       wait for the child process by using SysJoin()
+ *       put its exit status to register 2
+ *       increase pc
+ */
+void SysJoinHandler()
+{
+    int id = kernel->machine->ReadRegister(4);
+
+    kernel->machine->WriteRegister(2, (int)SysJoin(id));
+
+    return IncreasePC();
+}
+
+/** Handle sleep system call.
+ * @idea get the number of ticks from register 4
+ *       sleep for that long by using SysSleep()
+ *       increase pc
+ */
+void SysSleepHandler()
+{
+    int ticks = kernel->machine->ReadRegister(4);
+
+    DEBUG(dbgSys, "Sleep for " << ticks << " ticks\n");
+
+    SysSleep(ticks);
+
+    return IncreasePC();
+}
+
+/** Handle thread fork system call.
+ * @idea get the address of the procedure from register 4
+ *       get the address it returns to from register 5 (set by the stub in start.S)
+ *       start a new thread running it by using SysThreadFork()
+ *       put the thread id (or -1) to register 2
+ *       increase pc
+ */
+void SysThreadForkHandler()
+{
+    int func = kernel->machine->ReadRegister(4);
+    int returnAddr = kernel->machine->ReadRegister(5);
+
+    DEBUG(dbgSys, "ThreadFork at " << func << "\n");
+
+    kernel->machine->WriteRegister(2, (int)SysThreadFork(func, returnAddr));
+
+    return IncreasePC();
+}
+
+/** Handle thread yield system call.
+ * @idea let other threads run by using SysThreadYield()
+ *       increase pc
+ */
+void SysThreadYieldHandler()
+{
+    SysThreadYield();
+
+    return IncreasePC();
+}
+
+/** Handle thread join system call.
+ * @idea get thread id from register 4
+ *       wait for the thread by using SysThreadJoin()
+ *       put its exit status to register 2
+ *       increase pc
+ */
+void SysThreadJoinHandler()
+{
+    int id = kernel->machine->ReadRegister(4);
+
+    kernel->machine->WriteRegister(2, (int)SysThreadJoin(id));
+
+    return IncreasePC();
+}
+
+/** Handle thread exit system call.
+ * @idea get exit status from register 4
+ *       exit the current thread by using SysThreadExit(), which never returns
+ */
+void SysThreadExitHandler()
+{
+    int status = kernel->machine->ReadRegister(4);
+
+    DEBUG(dbgSys, "ThreadExit with status " << status << "\n");
+
+    SysThreadExit(status);
+
+    ASSERTNOTREACHED();
+}
+
+/** Handle set priority system call.
+ * @idea get the priority from register 4
+ *       set it by using SysSetPriority()
+ *       increase pc
+ */
+void SysSetPriorityHandler()
+{
+    int priority = kernel->machine->ReadRegister(4);
+
+    DEBUG(dbgSys, "SetPriority " << priority << "\n");
+
+    SysSetPriority(priority);
+
+    return IncreasePC();
+}
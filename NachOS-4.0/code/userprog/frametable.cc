@@ -0,0 +1,365 @@
+// frametable.cc
+//	Routines to manage the physical page frames, and the page
+//	replacement policies.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "frametable.h"
+#include "addrspace.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table; all physical frames start out free.
+//
+//	"replacePolicy" -- how to choose a frame to evict when there is
+//		no free frame.  Deleted along with the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(ReplacementPolicy *replacePolicy)
+{
+    for (int i = 0; i < NumPhysPages; i++) {
+	frames[i].space = NULL;
+	frames[i].virtualPage = -1;
+	frames[i].age = 0;
+	frames[i].image = -1;
+	frames[i].sharers = NULL;
+    }
+    freeMap = new Bitmap(NumPhysPages);
+    policy = replacePolicy;
+    lock = new Lock("frame table");
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable()
+{
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (frames[i].sharers != NULL) {
+	    delete frames[i].sharers;
+	}
+    }
+    delete freeMap;
+    delete policy;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Acquire, FrameTable::Release
+// 	Lock and unlock the frame table.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Acquire()
+{
+    lock->Acquire();
+}
+
+void
+FrameTable::Release()
+{
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Allocate
+// 	Find a physical frame to hold a virtual page.  If all frames are
+//	in use, ask the replacement policy for a victim, and have its
+//	owner push the page out first (which may write it to swap), or,
+//	if the victim is shared, have every address space using it 
+//	forget it.
+//
+//	Returns the frame number.  The caller fills in the contents of
+//	the frame, and the page table entry.
+//
+//	"space" -- the address space that needs the frame
+//	"virtualPage" -- the virtual page that will live in the frame
+//	"image" -- if not -1, the identity of the executable the page
+//		comes from; the frame is shared, and "space" is its first
+//		user
+//----------------------------------------------------------------------
+
+int
+FrameTable::Allocate(AddrSpace *space, int virtualPage, int image)
+{
+    int frame;
+
+    ASSERT(lock->IsHeldByCurrentThread());
+
+    frame = freeMap->FindAndSet();
+    if (frame == -1) {
+	frame = policy->ChooseVictim(this);
+	DEBUG(dbgAddr, "Evicting virtual page " << frames[frame].virtualPage
+		<< " from frame " << frame << " (" << policy->getName() << ")");
+	if (frames[frame].sharers != NULL) {
+	    while (!frames[frame].sharers->IsEmpty()) {
+		frames[frame].sharers->RemoveFront()->Evict(
+						frames[frame].virtualPage);
+	    }
+	    delete frames[frame].sharers;
+	    frames[frame].image = -1;
+	    frames[frame].sharers = NULL;
+	} else {
+	    ASSERT(frames[frame].space != NULL);
+	    frames[frame].space->Evict(frames[frame].virtualPage);
+	}
+    }
+    frames[frame].virtualPage = virtualPage;
+    frames[frame].age = 0;
+    if (image == -1) {
+	frames[frame].space = space;
+    } else {
+	frames[frame].space = NULL;
+	frames[frame].image = image;
+	frames[frame].sharers = new List<AddrSpace *>;
+	frames[frame].sharers->Append(space);
+    }
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Free
+// 	Return a frame to the pool of free frames, because its owner no
+//	longer needs the page in it (or is going away).  Shared frames
+//	are not freed, but Unshared.
+//
+//	"frame" -- the frame to free
+//----------------------------------------------------------------------
+
+void
+FrameTable::Free(int frame)
+{
+    ASSERT(lock->IsHeldByCurrentThread());
+    ASSERT(frames[frame].space != NULL);
+
+    frames[frame].space = NULL;
+    frames[frame].virtualPage = -1;
+    freeMap->Clear(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindShared
+// 	Look for a shared frame holding a page of an executable, that
+//	another address space running the same program has loaded.
+//
+//	Returns the frame, or -1 if there is none.
+//
+//	"image" -- the identity of the executable's file
+//	"virtualPage" -- the page of the executable
+//----------------------------------------------------------------------
+
+int
+FrameTable::FindShared(int image, int virtualPage)
+{
+    ASSERT(lock->IsHeldByCurrentThread());
+    ASSERT(image != -1);
+
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (frames[i].sharers != NULL && frames[i].image == image
+		&& frames[i].virtualPage == virtualPage) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share, FrameTable::Unshare
+// 	An address space starts (or stops) mapping a shared frame.  The
+//	frame keeps its page when nobody maps it; it is reclaimed only by
+//	the replacement policy.  A frame whose file has changed since,
+//	though, is of no use to anybody any more, and is freed.
+//
+//	"frame" -- the shared frame
+//	"space" -- the address space
+//----------------------------------------------------------------------
+
+void
+FrameTable::Share(int frame, AddrSpace *space)
+{
+    ASSERT(lock->IsHeldByCurrentThread());
+    ASSERT(frames[frame].sharers != NULL);
+
+    frames[frame].sharers->Append(space);
+}
+
+void
+FrameTable::Unshare(int frame, AddrSpace *space)
+{
+    ASSERT(lock->IsHeldByCurrentThread());
+    ASSERT(frames[frame].sharers != NULL);
+
+    frames[frame].sharers->Remove(space);
+    if (frames[frame].sharers->IsEmpty() && frames[frame].image == -1) {
+	FreeShared(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Forget
+// 	A file was written or removed, so the shared frames holding pages
+//	of it hold an old version.  Free those nobody maps; mark the
+//	others as belonging to no file, so that FindShared never returns
+//	them.  The address spaces mapping them keep those pages, but
+//	their other pages still come from the file.
+//
+//	Unlike the other operations, this one locks the frame table
+//	itself, since it is called by the file system calls.
+//
+//	"image" -- the identity of the file, or -1 for none
+//----------------------------------------------------------------------
+
+void
+FrameTable::Forget(int image)
+{
+    if (image == -1) {
+	return;
+    }
+    lock->Acquire();
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (frames[i].sharers != NULL && frames[i].image == image) {
+	    DEBUG(dbgAddr, "Forgetting frame " << i << " of file " << image);
+	    if (frames[i].sharers->IsEmpty()) {
+		FreeShared(i);
+	    } else {
+		frames[i].image = -1;
+	    }
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FreeShared
+// 	Free a shared frame that nobody maps.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::FreeShared(int frame)
+{
+    ASSERT(frames[frame].sharers->IsEmpty());
+
+    delete frames[frame].sharers;
+    frames[frame].image = -1;
+    frames[frame].sharers = NULL;
+    frames[frame].virtualPage = -1;
+    freeMap->Clear(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Used
+// 	Return TRUE if the page in a frame has been used since its use
+//	bit was last cleared -- by any of the address spaces mapping it,
+//	if the frame is shared.
+//
+//	"frame" -- the frame, which must be in use
+//----------------------------------------------------------------------
+
+bool
+FrameTable::Used(int frame)
+{
+    FrameEntry *entry = &frames[frame];
+
+    if (entry->sharers == NULL) {
+	ASSERT(entry->space != NULL);
+	return entry->space->PageTableEntry(entry->virtualPage)->use;
+    }
+
+    ListIterator<AddrSpace *> iter(entry->sharers);
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->PageTableEntry(entry->virtualPage)->use) {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ClearUse
+// 	Clear the use bit of the page in a frame, in every mapping of it.
+//	The simulator caches translations whose use bit is already set,
+//	so it has to be told.
+//
+//	"frame" -- the frame, which must be in use
+//----------------------------------------------------------------------
+
+void
+FrameTable::ClearUse(int frame)
+{
+    FrameEntry *entry = &frames[frame];
+
+    if (entry->sharers == NULL) {
+	ASSERT(entry->space != NULL);
+	entry->space->PageTableEntry(entry->virtualPage)->use = FALSE;
+	entry->space->InvalidateTranslation(entry->virtualPage);
+	return;
+    }
+
+    ListIterator<AddrSpace *> iter(entry->sharers);
+    for (; !iter.IsDone(); iter.Next()) {
+	iter.Item()->PageTableEntry(entry->virtualPage)->use = FALSE;
+	iter.Item()->InvalidateTranslation(entry->virtualPage);
+    }
+}
+
+//----------------------------------------------------------------------
+// ClockPolicy::ChooseVictim
+// 	Advance the clock hand until it points at a frame whose page has
+//	not been used since the last sweep, giving every used page a
+//	second chance by clearing its use bit on the way.
+//
+//	"frames" -- the frame table, with all frames in use
+//----------------------------------------------------------------------
+
+int
+ClockPolicy::ChooseVictim(FrameTable *frames)
+{
+    for (;;) {
+	int frame = hand;
+
+	hand = (hand + 1) % NumPhysPages;
+	if (!frames->Used(frame)) {
+	    return frame;
+	}
+	frames->ClearUse(frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// AgingPolicy::ChooseVictim
+// 	Age every frame by shifting its use bit into the top of its age
+//	counter (and clearing the use bit), then choose the frame with
+//	the smallest age, i.e., the one used least recently.
+//
+//	"frames" -- the frame table, with all frames in use
+//----------------------------------------------------------------------
+
+int
+AgingPolicy::ChooseVictim(FrameTable *frames)
+{
+    int victim = -1;
+
+    for (int frame = 0; frame < NumPhysPages; frame++) {
+	FrameEntry *info = frames->Entry(frame);
+
+	info->age >>= 1;
+	if (frames->Used(frame)) {
+	    info->age |= 0x80;
+	    frames->ClearUse(frame);
+	}
+	if (victim == -1 || info->age < frames->Entry(victim)->age) {
+	    victim = frame;
+	}
+    }
+    ASSERT(victim != -1);
+    return victim;
+}
@@ -0,0 +1,144 @@
+// frametable.h
+//	Data structures to manage the physical page frames of the
+//	simulated machine on behalf of all address spaces.
+//
+//	Every frame of "mainMemory" is either free, or holds one virtual
+//	page of one address space, or is shared: it holds a page of an
+//	executable, exactly as loaded from the file, mapped read-only by
+//	every address space running that executable (see AddrSpace::
+//	PageFault).  A shared frame stays around when the last address
+//	space using it goes away, so that the next run of the program
+//	can find it.
+//
+//	Shared frames are found by the identity of the executable's file
+//	(see OpenFile::Identity), not by its name, so that "x" and "./x"
+//	share.  When a file is written or removed, the frames holding
+//	pages of the old version must be forgotten (see Forget).  Address
+//	spaces still mapping them keep them, but nobody else can find
+//	them.  Pages a running program has not touched yet, though, are
+//	still loaded from the file, so they come from the new version.
+//
+//	When a page fault finds no free frame, a replacement policy
+//	chooses a victim, and the address space that owns it pushes the
+//	page out (to swap, if it has to) before the frame is reused.  A
+//	shared frame is never modified, so its users simply forget it.
+//
+//	The replacement policy is pluggable: anything derived from
+//	ReplacementPolicy can be handed to the FrameTable when the kernel
+//	starts up (see the -vm flag in kernel.cc).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "bitmap.h"
+#include "list.h"
+
+class AddrSpace;
+class Lock;
+class FrameTable;
+
+// The following class records what is stored in one physical frame.
+
+class FrameEntry {
+  public:
+    AddrSpace *space;		// the address space using this frame,
+				// or NULL if the frame is free or shared
+    int virtualPage;		// which of its virtual pages is here
+    unsigned char age;		// recent history of the use bit, for
+				// approximating LRU
+    int image;			// for a shared frame, the identity of
+    				// the executable the page belongs to, or
+				// -1 if that file has changed since
+    List<AddrSpace *> *sharers;	// for a shared frame, the address spaces
+    				// mapping it (possibly none); otherwise
+				// NULL
+};
+
+// The following class defines the interface to a page replacement
+// policy.  ChooseVictim is called, with the frame table locked, when
+// there is no free frame; it must return a frame that is in use.
+
+class ReplacementPolicy {
+  public:
+    virtual ~ReplacementPolicy() {}
+    virtual const char *getName() = 0;	// for debugging and statistics
+    virtual int ChooseVictim(FrameTable *frames) = 0;
+    				// Return the frame to evict
+};
+
+// Second chance ("clock"): sweep around the frames, clearing use bits,
+// and evict the first frame whose use bit is already clear.
+
+class ClockPolicy : public ReplacementPolicy {
+  public:
+    ClockPolicy() { hand = 0; }
+    const char *getName() { return "clock"; }
+    int ChooseVictim(FrameTable *frames);
+
+  private:
+    int hand;			// where the sweep continues next time
+};
+
+// Aging, an approximation of least recently used: each time we need a
+// victim, shift every frame's use bit into the top of its age counter
+// (clearing the use bit), and evict the frame with the smallest age.
+
+class AgingPolicy : public ReplacementPolicy {
+  public:
+    const char *getName() { return "lru"; }
+    int ChooseVictim(FrameTable *frames);
+};
+
+// The following class defines the frame table.  There is only one,
+// kernel->frameTable.  The caller must hold the frame table's lock
+// (Acquire/Release) around any sequence of operations, which keeps
+// page faults, evictions, and address space teardown from stepping
+// on each other while one of them waits for I/O.
+
+class FrameTable {
+  public:
+    FrameTable(ReplacementPolicy *replacePolicy);
+    				// Initialize: all frames free
+    ~FrameTable();		// De-allocate the frame table
+
+    void Acquire();		// Lock/unlock the frame table
+    void Release();
+
+    int Allocate(AddrSpace *space, int virtualPage, int image = -1);
+    				// Get a frame for a virtual page,
+				// evicting another page if necessary;
+				// shared if "image" is not -1
+    void Free(int frame);	// The frame's page is no longer needed
+
+    int FindShared(int image, int virtualPage);
+    				// Return the shared frame holding a page
+				// of an executable, or -1
+    void Share(int frame, AddrSpace *space);
+    void Unshare(int frame, AddrSpace *space);
+    				// Start or stop using a shared frame
+    void Forget(int image);	// A file changed; shared frames holding
+    				// its old pages can no longer be found.
+				// Locks the frame table itself
+
+    FrameEntry *Entry(int frame) { return &frames[frame]; }
+    bool Used(int frame);	// Was the frame used since its use bits
+    				// were last cleared?
+    void ClearUse(int frame);	// Clear the use bits of a frame's mappings
+    int NumFree() { return freeMap->NumClear(); }
+
+  private:
+    FrameEntry frames[NumPhysPages];	// what is in each frame
+    Bitmap *freeMap;		// which frames are in use
+    ReplacementPolicy *policy;	// how to choose a victim
+    Lock *lock;			// serializes paging activity
+
+    void FreeShared(int frame);	// Free a shared frame nobody maps
+};
+
+#endif // FRAMETABLE_H
@@ -13,6 +13,8 @@
 
 #include "kernel.h"
 #include "synchconsole.h"
+#include "ptable.h"
+#include "frametable.h"
 #include <cstring>
 #include <string>
 #include <climits>
@@ -241,61 +243,78 @@ int SysClose(OpenFileId id)
 
 /** Read from a file or from stdin if id is CONSOLE_INPUT
  *
- * @param length maximum characters to read
+ * @param buffer kernel buffer to store the bytes read
+ * @param length maximum bytes to read
  * @param id file id
- * @return characters read if successful, NULL otherwise (e.g. id is invalid or is not opened)
- * @idea using fileSystem->Read function to read from a file
- * @note we changed fileSytem->Read function in filesys/filesys.h
+ * @return number of bytes read, 0 if nothing could be read (e.g. end of file, id is invalid or is not opened)
+ * @idea using synchConsoleIn to read each character until a new line (which is kept) or EOF is reached
+ *       or the length is reached, otherwise using fileSystem->Read function to read from a file
+ * @note the bytes are not null-terminated, any byte value can be read
  */
-char* SysRead(int length, OpenFileId id)
+int SysRead(char* buffer, int length, OpenFileId id)
 {
-    // if id is stdout return NULL
-    if (id == CONSOLE_OUTUT)
-        return NULL;
+    if (buffer == NULL || length <= 0 || id == CONSOLE_OUTUT)
+        return 0;
 
-    // if id is stdin then read from keyboard
+    // if id is stdin then read from keyboard, at most one line at a time
     if (id == CONSOLE_INPUT)
-        return SysReadString(length);
+    {
+        int count = 0;
 
-    char* buffer = new char[length + 1];
+        while (count < length)
+        {
+            char c = kernel->synchConsoleIn->GetChar();
 
-    int count = kernel->fileSystem->Read(buffer, length, id);
+            if (c == EOF)
+                break;
 
-    // read nothing then return NULL
-    if (count == 0)
-    {
-        delete[] buffer;
-        return NULL;
-    }
+            buffer[count++] = c;
 
-    // read less than maximum length then at position count add a null character to skip the rest of the characters
-    if (count != length)
-        buffer[count] = '\0';
+            if (c == '\n')
+                break;
+        }
 
-    return buffer;
+        return count;
+    }
+
+    return kernel->fileSystem->Read(buffer, length, id);
 }
 
 /** Write to a file or to stdout if id is CONSOLE_OUTPUT
  *
- * @param buffer string to write
+ * @param buffer kernel buffer holding the bytes to write
+ * @param length number of bytes to write
  * @param id file id
- * @return number of characters written
- * @idea using fileSystem->Write function to write to a file
- * @note we changed fileSytem->Write function in filesys/filesys.h
+ * @return number of bytes written
+ * @idea using synchConsoleOut to print each byte to the console,
+ *       otherwise using fileSystem->Write function to write to a file, then frameTable->Forget
+ * @note the bytes do not need to be null-terminated, any byte value can be written
  */
-int SysWrite(char* buffer, OpenFileId id)
+int SysWrite(char* buffer, int length, OpenFileId id)
 {
-    if (buffer == NULL || id == CONSOLE_INPUT)
+    int result;
+
+    if (buffer == NULL || length <= 0 || id == CONSOLE_INPUT)
         return 0;
 
-    // if id is stdout then print to console and return the length of the string
+    // if id is stdout then print to console
     if (id == CONSOLE_OUTUT)
     {
-        SysPrintString(buffer);
-        return strlen(buffer);
+        for (int i = 0; i < length; i++)
+            kernel->synchConsoleOut->PutChar(buffer[i]);
+
+        return length;
     }
 
-    return kernel->fileSystem->Write(buffer, strlen(buffer), id);
+    result = kernel->fileSystem->Write(buffer, length, id);
+
+#ifdef FILESYS_STUB
+    // pages of the file that programs share are out of date now
+    if (result > 0)
+        kernel->frameTable->Forget(kernel->fileSystem->Identity(id));
+#endif
+
+    return result;
 }
 
 /** Seek a file
@@ -316,12 +335,138 @@ int SysSeek(int position, OpenFileId id)
  *
  * @param name file name
  * @return 0 if successful, -1 otherwise (e.g. file does not exist)
- * @idea using fileSystem->Remove function to remove a file
+ * @idea using fileSystem->Remove function to remove a file, then frameTable->Forget
  * @note we changed fileSytem->Remove function in filesys/filesys.h
  */
 int SysRemove(char* name)
 {
-    return kernel->fileSystem->Remove(name);
+    OpenFile* file = kernel->fileSystem->Open(name);
+    int image = -1;
+    int result;
+
+    // find out which file it is first, to forget its shared pages after
+    if (file != NULL)
+    {
+        image = file->Identity();
+        delete file;
+    }
+
+    result = kernel->fileSystem->Remove(name);
+
+    if (result == 0)
+        kernel->frameTable->Forget(image);
+
+    return result;
+}
+
+/** Run a program in a new process
+ *
+ * @param name file name of the program
+ * @return process id if successful, -1 otherwise (e.g. file does not exist or too many processes)
+ * @idea using processTable->Exec function to load the program and fork a thread to run it
+ */
+SpaceId SysExec(char* name)
+{
+    if (name == NULL || strlen(name) == 0)
+        return -1;
+
+    return kernel->processTable->Exec(name, 0, NULL);
+}
+
+/** Run a program in a new process, with arguments
+ *
+ * @param argc number of arguments
+ * @param argv arguments in kernel space, argv[0] is the file name of the program
+ * @return process id if successful, -1 otherwise
+ * @idea using processTable->Exec function, which also pushes the arguments onto the new program's stack
+ * @note the process table takes over argv (and its strings), even when Exec fails
+ */
+SpaceId SysExecV(int argc, char** argv)
+{
+    return kernel->processTable->Exec(argv[0], argc, argv);
+}
+
+/** Wait for a child process to exit
+ *
+ * @param id process id returned by Exec
+ * @return exit status of the child, -1 if id is not a child of the current process
+ * @idea using processTable->Join function to wait for the child
+ */
+int SysJoin(SpaceId id)
+{
+    return kernel->processTable->Join(id);
+}
+
+/** Exit the current process
+ *
+ * @param status exit status, for the parent
+ * @idea using processTable->Exit function, which never returns
+ */
+void SysExit(int status)
+{
+    kernel->processTable->Exit(status);
+}
+
+/** Start a new thread in the current process
+ *
+ * @param func address of the procedure the thread runs
+ * @param returnAddr address the procedure returns to, which calls ThreadExit
+ * @return thread id if successful, -1 otherwise (too many threads in the process)
+ * @idea using processTable->ThreadFork function, which gives the thread its own user stack
+ */
+ThreadId SysThreadFork(int func, int returnAddr)
+{
+    return kernel->processTable->ThreadFork(func, returnAddr);
+}
+
+/** Let another thread run
+ *
+ * @idea using currentThread->Yield, which puts the thread back on the ready list
+ */
+void SysThreadYield()
+{
+    kernel->currentThread->Yield();
+}
+
+/** Wait for a thread of the current process to exit
+ *
+ * @param id thread id returned by ThreadFork, or 0 for the first thread
+ * @return exit status of the thread, -1 if there is no such thread or it is already joined
+ * @idea using processTable->ThreadJoin function to wait for the thread
+ */
+int SysThreadJoin(ThreadId id)
+{
+    return kernel->processTable->ThreadJoin(id);
+}
+
+/** Exit the current thread
+ *
+ * @param status exit status, for ThreadJoin
+ * @idea using processTable->ThreadExit function, which never returns; the process exits with its last thread
+ */
+void SysThreadExit(int status)
+{
+    kernel->processTable->ThreadExit(status);
+}
+
+/** Sleep for a while
+ *
+ * @param ticks how many ticks of simulated time to sleep
+ * @idea using alarm->WaitUntil, which takes the thread off the ready list until the time is up
+ */
+void SysSleep(int ticks)
+{
+    kernel->alarm->WaitUntil(ticks);
+}
+
+/** Set the scheduling priority of the current thread
+ *
+ * @param priority the new priority, clamped to 0..MaxPriority
+ * @idea using currentThread->setPriority; the scheduling policy looks at it from the next time slice on
+ */
+void SysSetPriority(int priority)
+{
+    kernel->currentThread->setPriority(priority);
 }
 
 #endif /* ! __USERPROG_KSYSCALL_H__ */
@@ -0,0 +1,582 @@
+// ptable.cc
+//	Routines to start, wait for, and clean up after user programs
+//	running at the same time.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "ptable.h"
+#include "main.h"
+#include "addrspace.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// UserThread::UserThread
+// 	Initialize the entry of a user thread, that has not exited.
+//
+//	"owner" -- the process the thread runs in
+//	"threadId" -- the entry's index in the process's threads
+//	"kernelThread" -- the kernel thread that runs it
+//----------------------------------------------------------------------
+
+UserThread::UserThread(Process *owner, int threadId, Thread *kernelThread)
+{
+    process = owner;
+    id = threadId;
+    thread = kernelThread;
+    func = 0;
+    returnAddr = 0;
+    exited = FALSE;
+    exitStatus = 0;
+    joined = FALSE;
+    done = new Semaphore("user thread", 0);
+}
+
+//----------------------------------------------------------------------
+// UserThread::~UserThread
+// 	De-allocate the entry of a user thread, once it has exited and
+//	its kernel thread is gone.
+//----------------------------------------------------------------------
+
+UserThread::~UserThread()
+{
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// Process::Process
+// 	Initialize a process control block.
+//
+//	"processId" -- the process's index in the process table
+//	"parentProcessId" -- the process that may Join it, or -1
+//	"fileName" -- the executable (copied)
+//	"addrSpace" -- the loaded address space, deleted at Exit
+//	"numArgs", "args" -- arguments for main(); "args" and the
+//		strings it points to are deleted along with the process
+//----------------------------------------------------------------------
+
+Process::Process(int processId, int parentProcessId, char *fileName,
+		AddrSpace *addrSpace, int numArgs, char **args)
+{
+    id = processId;
+    parentId = parentProcessId;
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    space = addrSpace;
+    argc = numArgs;
+    argv = args;
+    exited = FALSE;
+    exitStatus = 0;
+    joined = FALSE;
+    done = new Semaphore(name, 0);
+    threads = new UserThread *[MaxUserThreads];
+    for (int i = 0; i < MaxUserThreads; i++) {
+	threads[i] = NULL;
+    }
+    numThreads = 0;
+    exiting = FALSE;
+    threadExited = new Condition(name);
+}
+
+//----------------------------------------------------------------------
+// Process::~Process
+// 	De-allocate a process control block, once the process has
+//	exited and its thread is gone.
+//----------------------------------------------------------------------
+
+Process::~Process()
+{
+    for (int i = 0; i < argc; i++) {
+	delete [] argv[i];
+    }
+    delete [] argv;
+    for (int i = 0; i < MaxUserThreads; i++) {
+	if (threads[i] != NULL) {
+	    delete threads[i];
+	}
+    }
+    delete [] threads;
+    delete done;
+    delete threadExited;
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// StartProcess
+// 	The first thing a new process's kernel thread runs: jump to the
+//	program, passing it its arguments.
+//
+//	"arg" -- the process, as a void * so that we can Fork it
+//----------------------------------------------------------------------
+
+static void
+StartProcess(void *arg)
+{
+    Process *process = (Process *) arg;
+
+    process->space->Execute(process->argc, process->argv);
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// StartUserThread
+// 	The first thing the kernel thread of a forked user thread runs:
+//	jump to the procedure it was forked to run, on its own stack.
+//
+//	"arg" -- the user thread, as a void * so that we can Fork it
+//----------------------------------------------------------------------
+
+static void
+StartUserThread(void *arg)
+{
+    UserThread *userThread = (UserThread *) arg;
+
+    userThread->process->space->ExecuteThread(userThread->id,
+    			userThread->func, userThread->returnAddr);
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ProcessTable
+// 	Initialize the process table; no process is running yet.
+//----------------------------------------------------------------------
+
+ProcessTable::ProcessTable()
+{
+    for (int i = 0; i < MaxProcesses; i++) {
+	processes[i] = NULL;
+    }
+    lock = new Lock("process table");
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::~ProcessTable
+// 	De-allocate the process table, when Nachos halts.  Address spaces
+//	of processes that are still running are not worth cleaning up.
+//----------------------------------------------------------------------
+
+ProcessTable::~ProcessTable()
+{
+    for (int i = 0; i < MaxProcesses; i++) {
+	if (processes[i] != NULL) {
+	    delete processes[i];
+	}
+    }
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::FreeEntry
+// 	Find an unused entry in the table.  An entry whose process has
+//	exited, and that nobody can Join any more, can be reused: its
+//	thread is gone, since a process sets "exited" only when it is
+//	about to finish, with interrupts off.
+//
+//	Returns -1 if the table is full.  The table must be locked.
+//----------------------------------------------------------------------
+
+int
+ProcessTable::FreeEntry()
+{
+    for (int i = 0; i < MaxProcesses; i++) {
+	if (processes[i] != NULL && processes[i]->exited
+		&& processes[i]->parentId == -1) {
+	    delete processes[i];
+	    processes[i] = NULL;
+	}
+	if (processes[i] == NULL) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Current
+// 	Return the process that the current thread belongs to.
+//	The table must be locked.
+//----------------------------------------------------------------------
+
+Process *
+ProcessTable::Current()
+{
+    AddrSpace *space = kernel->currentThread->space;
+
+    for (int i = 0; i < MaxProcesses; i++) {
+	if (processes[i] != NULL && processes[i]->space == space) {
+	    return processes[i];
+	}
+    }
+    ASSERTNOTREACHED();		// every user thread is in some process
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::CurrentThread
+// 	Return the entry of the current thread, among the threads of the
+//	process it belongs to.  The table must be locked.
+//
+//	"process" -- the current process
+//----------------------------------------------------------------------
+
+UserThread *
+ProcessTable::CurrentThread(Process *process)
+{
+    for (int i = 0; i < MaxUserThreads; i++) {
+	if (process->threads[i] != NULL
+		&& process->threads[i]->thread == kernel->currentThread) {
+	    return process->threads[i];
+	}
+    }
+    ASSERTNOTREACHED();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Attach
+// 	Enter the program started from the command line into the table.
+//	It runs in the current thread (the main thread), which has
+//	nothing else to do, and has no parent to Join it.
+//
+//	"fileName" -- the executable
+//	"space" -- its address space, about to be run by the current thread
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Attach(char *fileName, AddrSpace *space)
+{
+    int id;
+
+    lock->Acquire();
+    id = FreeEntry();
+    ASSERT(id != -1);
+    processes[id] = new Process(id, -1, fileName, space, 0, NULL);
+    processes[id]->threads[0] = new UserThread(processes[id], 0,
+    						kernel->currentThread);
+    processes[id]->numThreads = 1;
+    kernel->currentThread->space = space;
+    lock->Release();
+    return id;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Exec
+// 	Start a new process, as a child of the current one.  The program
+//	is loaded here, so that a bad file name can be reported to the
+//	caller; it starts running whenever the scheduler gets to it.
+//
+//	Returns the id of the new process, or -1 if the program cannot
+//	be loaded or the table is full (argv is deleted in that case).
+//
+//	"fileName" -- the executable
+//	"argc", "argv" -- arguments for its main(); argc may be 0
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Exec(char *fileName, int argc, char **argv)
+{
+    AddrSpace *space = new AddrSpace;
+    Process *process;
+    Thread *thread;
+    int id;
+
+    lock->Acquire();
+    id = FreeEntry();
+    if (id == -1 || !space->Load(fileName)) {
+	lock->Release();
+	DEBUG(dbgAddr, "Unable to exec " << fileName);
+	delete space;
+	for (int i = 0; i < argc; i++) {
+	    delete [] argv[i];
+	}
+	delete [] argv;
+	return -1;
+    }
+    process = new Process(id, Current()->id, fileName, space, argc, argv);
+    processes[id] = process;
+    lock->Release();
+
+    DEBUG(dbgAddr, "Exec " << fileName << " as process " << id);
+    thread = new Thread(process->name);
+    thread->setPriority(kernel->currentThread->getPriority());
+    process->threads[0] = new UserThread(process, 0, thread);
+    process->numThreads = 1;
+    thread->space = space;
+    thread->Fork(StartProcess, (void *) process);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Join
+// 	Wait until a child of the current process exits, then remove it
+//	from the table.
+//
+//	Returns the child's exit status, or -1 if "id" does not name a
+//	child of the current process, or names one that another thread
+//	of the process is Joining, or has Joined already.
+//
+//	"id" -- the child to wait for
+//----------------------------------------------------------------------
+
+int
+ProcessTable::Join(int id)
+{
+    Process *child;
+    int status;
+
+    lock->Acquire();
+    if (id < 0 || id >= MaxProcesses || processes[id] == NULL
+		|| processes[id]->parentId != Current()->id
+		|| processes[id]->joined) {
+	lock->Release();
+	return -1;
+    }
+    child = processes[id];
+    child->joined = TRUE;
+    lock->Release();
+
+    child->done->P();		// wait until it exits
+
+    lock->Acquire();
+    status = child->exitStatus;
+    processes[id] = NULL;
+    delete child;
+    lock->Release();
+    return status;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::Exit
+// 	The current process is done.  Wait for its other threads to
+//	exit, then give back its address space, wake up its parent (if
+//	it is waiting in Join), and finish the thread.  Children of the
+//	process can no longer be Joined by anybody, once none of its
+//	threads can be in the middle of Joining one.
+//
+//	The other threads are killed: each of them calls ThreadExit the
+//	next time it makes a system call, or is preempted in user code
+//	(see Alarm::CallBack and ExceptionHandler), and Exit waits until
+//	they all have.  Threads Joining the current one are let go first.
+//
+//	When the last process exits, there is nothing left for Nachos
+//	to do, so halt; this is what happened when a program exited,
+//	before there could be more than one.
+//
+//	"status" -- the exit status, for the parent
+//----------------------------------------------------------------------
+
+void
+ProcessTable::Exit(int status)
+{
+    Thread *thread = kernel->currentThread;
+    Process *process;
+    UserThread *self;
+    int running = 0;
+
+    lock->Acquire();
+    process = Current();
+    self = CurrentThread(process);
+    if (process->exiting) {		// another thread got here first
+	FinishThread(process, self, status);
+	ASSERTNOTREACHED();
+    }
+    process->exiting = TRUE;
+    self->exitStatus = status;
+    self->exited = TRUE;
+    self->thread = NULL;
+    self->done->V();
+    process->numThreads--;
+    for (int i = 0; i < MaxUserThreads; i++) {
+	if (process->threads[i] != NULL && !process->threads[i]->exited) {
+	    process->threads[i]->thread->killed = TRUE;
+	}
+    }
+    if (process->numThreads > 0) {	// make sure a time slice ends,
+	IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+	kernel->alarm->StartTicking();	// even in tickless mode
+	(void) kernel->interrupt->SetLevel(oldLevel);
+    }
+    while (process->numThreads > 0) {
+	process->threadExited->Wait(lock);
+    }
+    for (int i = 0; i < MaxProcesses; i++) {
+	if (processes[i] != NULL && processes[i]->parentId == process->id) {
+	    processes[i]->parentId = -1;	// orphaned
+	}
+    }
+    lock->Release();
+
+    DEBUG(dbgAddr, "Process " << process->id << " exits with " << status);
+    thread->space = NULL;
+    delete process->space;		// may wait for the frame table
+    process->space = NULL;
+
+    // From here on nothing else runs until this thread is gone, so
+    // that the entry cannot be reclaimed (or Joined) under our feet.
+    (void) kernel->interrupt->SetLevel(IntOff);
+    process->exitStatus = status;
+    process->exited = TRUE;
+    for (int i = 0; i < MaxProcesses; i++) {
+	if (processes[i] != NULL && !processes[i]->exited) {
+	    running++;
+	}
+    }
+    if (running == 0) {
+	kernel->interrupt->Halt();
+    }
+    process->done->V();
+    thread->Finish();
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ThreadFork
+// 	Start a new thread in the current process.  It gets a kernel
+//	thread of its own, and the user stack that goes with its entry;
+//	it starts running whenever the scheduler gets to it.
+//
+//	Returns the id of the new thread, or -1 if the process already
+//	has as many threads as it can, or is exiting.
+//
+//	"func" -- the user procedure the thread runs
+//	"returnAddr" -- where the thread goes when "func" returns, which
+//		had better call ThreadExit (see start.S)
+//----------------------------------------------------------------------
+
+int
+ProcessTable::ThreadFork(int func, int returnAddr)
+{
+    Process *process;
+    UserThread *userThread;
+    Thread *thread;
+    int id;
+
+    lock->Acquire();
+    process = Current();
+    for (id = 1; id < MaxUserThreads; id++) {
+	if (process->threads[id] == NULL) {
+	    break;
+	}
+    }
+    if (id == MaxUserThreads || process->exiting) {
+	lock->Release();
+	return -1;
+    }
+    thread = new Thread(process->name);
+    thread->setPriority(kernel->currentThread->getPriority());
+    userThread = new UserThread(process, id, thread);
+    userThread->func = func;
+    userThread->returnAddr = returnAddr;
+    process->threads[id] = userThread;
+    process->numThreads++;
+    lock->Release();
+
+    DEBUG(dbgAddr, "Process " << process->id << " forks thread " << id
+    			<< " at " << func);
+    thread->space = process->space;
+    thread->Fork(StartUserThread, (void *) userThread);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ThreadJoin
+// 	Wait until a thread of the current process exits, then free its
+//	entry, and its stack, for another thread.
+//
+//	Returns the thread's exit status, or -1 if "id" does not name a
+//	thread of the current process, or names the current thread, or
+//	one that another thread has Joined already.
+//
+//	"id" -- the thread to wait for
+//----------------------------------------------------------------------
+
+int
+ProcessTable::ThreadJoin(int id)
+{
+    Process *process;
+    UserThread *userThread;
+    int status;
+
+    lock->Acquire();
+    process = Current();
+    if (id < 0 || id >= MaxUserThreads || process->threads[id] == NULL
+		|| process->threads[id]->joined
+		|| process->threads[id] == CurrentThread(process)) {
+	lock->Release();
+	return -1;
+    }
+    userThread = process->threads[id];
+    userThread->joined = TRUE;
+    lock->Release();
+
+    userThread->done->P();	// wait until it exits
+
+    lock->Acquire();
+    status = userThread->exitStatus;
+    process->threads[id] = NULL;
+    delete userThread;
+    lock->Release();
+    return status;
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::ThreadExit
+// 	The current thread is done.  If it is the last thread of its
+//	process, the process exits, with the same status; otherwise, just
+//	the thread finishes.
+//
+//	"status" -- the exit status, for ThreadJoin
+//----------------------------------------------------------------------
+
+void
+ProcessTable::ThreadExit(int status)
+{
+    Process *process;
+
+    lock->Acquire();
+    process = Current();
+    if (process->numThreads == 1 && !process->exiting) {
+	lock->Release();
+	Exit(status);
+    } else {
+	FinishThread(process, CurrentThread(process), status);
+    }
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// ProcessTable::FinishThread
+// 	Finish the current thread, but not its process: record its exit
+//	status, and wake up whoever Joins it, and Exit, if it is waiting
+//	for the threads of the process to be done.  Never returns.
+//
+//	The table must be locked.  From the time the thread counts as
+//	exited, nothing else runs until it is gone, so that the process
+//	cannot go away under our feet.
+//
+//	"process" -- the current process
+//	"self" -- the current thread's entry in it
+//	"status" -- the exit status
+//----------------------------------------------------------------------
+
+void
+ProcessTable::FinishThread(Process *process, UserThread *self, int status)
+{
+    Thread *thread = kernel->currentThread;
+
+    DEBUG(dbgAddr, "Thread " << self->id << " of process " << process->id
+    			<< " exits with " << status);
+    (void) kernel->interrupt->SetLevel(IntOff);
+    self->exitStatus = status;
+    self->exited = TRUE;
+    self->thread = NULL;
+    self->done->V();
+    process->numThreads--;
+    process->threadExited->Signal(lock);
+    lock->Release();
+    thread->space = NULL;
+    thread->Finish();
+    ASSERTNOTREACHED();
+}
@@ -0,0 +1,145 @@
+// ptable.h
+//	Data structures to keep track of the user programs (processes)
+//	running at the same time.
+//
+//	Every process has its own address space, and an entry in the
+//	process table, kernel->processTable.  The entry's index is the
+//	SpaceId that Exec returns to the parent; it stays in the table
+//	after the process exits, holding the exit status, until the
+//	parent Joins it (or until the parent itself exits, so that nobody
+//	can Join it any more).
+//
+//	A process starts out with one user thread, and may ThreadFork
+//	more, up to MaxUserThreads, all running in its address space,
+//	each on a kernel thread and a user stack of its own.  Threads
+//	are known by a ThreadId, the index of their entry in the process
+//	control block; it is 0 for the first thread.  A thread's entry,
+//	and its stack, are only reused once it has exited and another
+//	thread of the process has Joined it.  The process exits when its
+//	last thread does, or when any thread calls Exit; in that case,
+//	Exit waits for the other threads to ThreadExit before the address
+//	space goes away.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PTABLE_H
+#define PTABLE_H
+
+#include "copyright.h"
+
+class AddrSpace;
+class Thread;
+class Lock;
+class Semaphore;
+class Condition;
+class Process;
+
+const int MaxProcesses = 16;		// entries in the process table
+
+// The following class defines a user thread, one of the threads
+// running a process.
+
+class UserThread {
+  public:
+    UserThread(Process *owner, int threadId, Thread *kernelThread);
+    ~UserThread();
+
+    Process *process;			// the process we belong to
+    int id;				// index in its table of threads;
+    					// also which user stack we use
+    Thread *thread;			// the kernel thread running us
+    int func;				// where a forked thread starts,
+    int returnAddr;			// and returns to when it is done
+
+    bool exited;			// has the thread called ThreadExit?
+    int exitStatus;			// if so, with what status
+    bool joined;			// is somebody waiting for it, or
+    					// done waiting?
+    Semaphore *done;			// signalled when the thread exits
+};
+
+// The following class defines a process control block.
+
+class Process {
+  public:
+    Process(int processId, int parentProcessId, char *fileName,
+		AddrSpace *addrSpace, int numArgs, char **args);
+    ~Process();
+
+    int id;				// index in the process table
+    int parentId;			// who may Join us, or -1 if nobody
+    char *name;				// the executable; also the name
+    					// of our kernel thread
+    AddrSpace *space;			// our address space
+    int argc;				// arguments to pass to main();
+    char **argv;			// argv is NULL if argc is 0
+
+    bool exited;			// has the process called Exit?
+    int exitStatus;			// if so, with what status
+    bool joined;			// is a thread of the parent waiting
+    					// for it, or done waiting?
+    Semaphore *done;			// signalled when the process exits
+
+    UserThread **threads;		// the threads of the process, up to
+    					// MaxUserThreads (see addrspace.h);
+					// NULL if the entry is free
+    int numThreads;			// how many have not exited yet
+    bool exiting;			// has some thread called Exit?
+    Condition *threadExited;		// signalled as each thread exits,
+    					// for Exit to wait on
+};
+
+// The following class defines the process table.
+
+class ProcessTable {
+  public:
+    ProcessTable();			// Initialize an empty table
+    ~ProcessTable();
+
+    int Attach(char *fileName, AddrSpace *space);
+    				// Make the current thread, which is about
+				// to run the address space, a process
+				// with no parent; used for the program
+				// started with -x
+    int Exec(char *fileName, int argc, char **argv);
+    				// Load a program into a new address space,
+				// and start a thread running it, as a child
+				// of the current process.  Takes over argv.
+				// Return its id, or -1 on failure
+    int Join(int id);		// Wait for a child to exit, and return
+    				// its exit status, or -1 if "id" is not
+				// a child of the current process
+    void Exit(int status);	// The current process is done; never
+				// returns.  Halts Nachos if this was the
+				// last process.
+
+    int ThreadFork(int func, int returnAddr);
+    				// Start a new thread in the current
+				// process, running the procedure at "func".
+				// Return its id, or -1 if the process has
+				// too many threads
+    int ThreadJoin(int id);	// Wait for a thread of the current process
+    				// to exit, and return its exit status, or
+				// -1 if there is no such thread (or it is
+				// already Joined)
+    void ThreadExit(int status);// The current thread is done; never
+    				// returns.  The process exits with it, if
+				// it is the last one
+
+  private:
+    Process *processes[MaxProcesses];	// NULL if the entry is free
+    Lock *lock;				// protects the table
+
+    int FreeEntry();			// find (or reclaim) an unused entry
+    Process *Current();			// the process the current thread
+    					// belongs to
+    UserThread *CurrentThread(Process *process);
+    					// the current thread's entry in it
+    void FinishThread(Process *process, UserThread *self, int status);
+    					// the current thread exits, but
+					// not the process
+};
+
+#endif // PTABLE_H
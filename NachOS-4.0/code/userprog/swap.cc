@@ -0,0 +1,89 @@
+// swap.cc
+//	Routines to manage the swap area.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swap.h"
+#include "machine.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Create an empty swap area, in a UNIX file named after this
+//	machine's host id (so that several Nachos can run side by side).
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace()
+{
+    sprintf(swapName, "SWAP_%d", kernel->hostName);
+    fileno = OpenForWrite(swapName);
+    slotMap = new Bitmap(NumSwapPages);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Throw away the swap area; nothing in it outlives Nachos.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    Close(fileno);
+    Unlink(swapName);
+    delete slotMap;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Reserve a free slot in the swap area.  Returns the slot number,
+//	or -1 if the swap area is full.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    return slotMap->FindAndSet();
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Free
+// 	Give a slot back, because the page stored there is no longer
+//	needed.
+//
+//	"slot" -- the slot to free
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(slotMap->Test(slot));
+    slotMap->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage, SwapSpace::WritePage
+// 	Read or write one page-sized slot of the swap area.
+//
+//	"slot" -- the slot to read or write
+//	"data" -- where to put the page, or the page to write
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *data)
+{
+    ASSERT(slotMap->Test(slot));
+    DEBUG(dbgAddr, "Reading swap slot " << slot);
+    Lseek(fileno, slot * PageSize, 0);
+    Read(fileno, data, PageSize);
+}
+
+void
+SwapSpace::WritePage(int slot, char *data)
+{
+    ASSERT(slotMap->Test(slot));
+    DEBUG(dbgAddr, "Writing swap slot " << slot);
+    Lseek(fileno, slot * PageSize, 0);
+    WriteFile(fileno, data, PageSize);
+}
@@ -0,0 +1,46 @@
+// swap.h
+//	Data structures to manage the swap area, where pages of user
+//	address spaces are kept when they have been pushed out of
+//	physical memory.
+//
+//	The swap area is a UNIX file (SWAP_<host id>) divided into
+//	page-sized slots.  Like the DISK file for the simulated disk, it
+//	lives outside of the Nachos file system, which is far too small
+//	to hold it; unlike the disk, it is scratch space, created empty
+//	when Nachos starts and removed when it halts.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+
+const int NumSwapPages = 1024;		// slots in the swap area
+
+// The following class defines the swap area.
+
+class SwapSpace {
+  public:
+    SwapSpace();			// Create an empty swap area
+    ~SwapSpace();			// Remove the swap area
+
+    int Allocate();			// Reserve a slot; return -1 if
+					// the swap area is full
+    void Free(int slot);		// Give a slot back
+
+    void ReadPage(int slot, char *data);
+    void WritePage(int slot, char *data);
+    					// Read or write a page-sized
+					// slot of the swap area
+
+  private:
+    char swapName[32];			// UNIX file name of the swap area
+    int fileno;				// UNIX file descriptor
+    Bitmap *slotMap;			// which slots are in use
+};
+
+#endif // SWAP_H
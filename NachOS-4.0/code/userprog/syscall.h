@@ -41,6 +41,8 @@
 #define SC_RandomNum 20
 #define SC_ReadString 21
 #define SC_PrintString 22
+#define SC_Sleep 23
+#define SC_SetPriority 24
 
 #define SC_Add		42
 
@@ -108,7 +110,15 @@ int Add(int op1, int op2);
 
 /* Address space control operations: Exit, Exec, Execv, and Join */
 
-/* This user program is done (status = 0 means exited normally). */
+/* This user program is done (status = 0 means exited normally).
+ * Nachos halts when the last running program exits.
+ *
+ * The program's other threads are killed: each one exits the next time
+ * it makes a system call or is preempted, and Exit waits until they
+ * all have.  A thread blocked in the kernel -- reading the console, or
+ * Joining a program that never exits -- only goes once it is woken up,
+ * so until then, Exit (and whoever Joins this program) waits too.
+ */
 void Exit(int status);
 
 /* A unique identifier for an executing user program (address space) */
@@ -117,19 +127,22 @@ typedef int SpaceId;
 /* A unique identifier for a thread within a task */
 typedef int ThreadId;
 
-/* Run the specified executable, with no args */
-/* This can be implemented as a call to ExecV.
+/* Run the specified executable, with no args, concurrently with the
+ * caller.  Return the address space identifier, or -1 if the program
+ * cannot be loaded.
  */
 SpaceId Exec(char* exec_name);
 
 /* Run the executable, stored in the Nachos file "argv[0]", with
  * parameters stored in argv[1..argc-1] and return the
- * address space identifier
+ * address space identifier (or -1).  The new program's main() is
+ * called as main(argc, argv).
  */
 SpaceId ExecV(int argc, char* argv[]);
 
 /* Only return once the user program "id" has finished.
- * Return the exit status.
+ * Return the exit status, or -1 if "id" was not Exec'ed by the
+ * caller (or has already been joined).
  */
 int Join(SpaceId id);
 
@@ -168,9 +181,9 @@ int Remove(char* name);
  */
 OpenFileId Open(char* name);
 
-/* Write "size" bytes from "buffer" to the open file.
- * Return the number of bytes actually read on success.
- * On failure, a negative error code is returned.
+/* Write "size" bytes from "buffer" to the open file.  Any byte values
+ * may be written; "buffer" need not be null-terminated.
+ * Return the number of bytes actually written (0 on failure).
  */
 int Write(char* buffer, int size, OpenFileId id);
 
@@ -179,6 +192,10 @@ int Write(char* buffer, int size, OpenFileId id);
  * long enough, or if it is an I/O device, and there aren't enough
  * characters to read, return whatever is available (for I/O devices,
  * you should always wait until you can return at least one character).
+ * The console returns at most one line, including its '\n'.
+ * No null character is added after the bytes read.
+ * Return -1 if "buffer" is not writable; the bytes read from the file
+ * by then are lost.
  */
 int Read(char* buffer, int size, OpenFileId id);
 
@@ -199,8 +216,10 @@ int Close(OpenFileId id);
  */
 
  /* Fork a thread to run a procedure ("func") in the *same* address space
-  * as the current thread.
+  * as the current thread, on a stack of its own.  Returning from "func"
+  * is the same as ThreadExit(0).
   * Return a positive ThreadId on success, negative error code on failure
+  * (a program has at most MaxUserThreads threads, see addrspace.h)
   */
 ThreadId ThreadFork(void (*func)());
 
@@ -220,6 +239,18 @@ int ThreadJoin(ThreadId id);
  */
 void ThreadExit(int ExitCode);
 
+/* Put the calling thread to sleep until (at least) "ticks" ticks of
+ * simulated time have passed.  Other threads run meanwhile.
+ */
+void Sleep(int ticks);
+
+/* Set the scheduling priority of the calling thread, from 0 (the
+ * default) to 9.  How much it matters depends on the scheduling policy
+ * Nachos was started with (see -sched in threads/main.cc).  Threads and
+ * programs started afterwards by the calling thread inherit it.
+ */
+void SetPriority(int priority);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */